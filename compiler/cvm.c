@@ -250,6 +250,10 @@
 #define TEST_AND_CLEAR_BIT_OPCODE 249
 #define STORE_WITH_BARRIER_OPCODE 250
 #define STORE_WITH_BARRIER_OPCODE_VAR_OFFSET 251
+//superinstructions
+#define SET_REG2_OPCODE_LOCAL 13
+#define RETURN_OPCODE_LOCAL 21
+#define POP_FRAME_GET_REG_OPCODE 29
 
 char* opcode_names[256];
 void init_opcode_names () {
@@ -495,6 +499,9 @@ void init_opcode_names () {
   opcode_names[TEST_AND_CLEAR_BIT_OPCODE] = "TEST_AND_CLEAR_BIT_OPCODE";
   opcode_names[STORE_WITH_BARRIER_OPCODE] = "STORE_WITH_BARRIER_OPCODE";
   opcode_names[STORE_WITH_BARRIER_OPCODE_VAR_OFFSET] = "STORE_WITH_BARRIER_OPCODE_VAR_OFFSET";
+  opcode_names[SET_REG2_OPCODE_LOCAL] = "SET_REG2_OPCODE_LOCAL";
+  opcode_names[RETURN_OPCODE_LOCAL] = "RETURN_OPCODE_LOCAL";
+  opcode_names[POP_FRAME_GET_REG_OPCODE] = "POP_FRAME_GET_REG_OPCODE";
 }
 
 //============================================================
@@ -557,13 +564,134 @@ void init_opcode_names () {
 #define F_JUMP(condition) \
   if(condition){ \
     pc = pc0 + (n1 * 4); \
-    continue; \
+    NEXT_INSTRUCTION(); \
   } \
   else{ \
     pc = pc0 + (n2 * 4); \
-    continue; \
+    NEXT_INSTRUCTION(); \
   }
 
+//============================================================
+//=================== OPCODE PROFILING =======================
+//============================================================
+//When CVM_PROFILE_OPCODES is defined, the interpreter counts how
+//often each pair and triple of opcodes is executed in sequence, and
+//prints the most frequent ones when the program exits. The most
+//frequent sequences are the candidates for new superinstructions.
+
+#ifdef CVM_PROFILE_OPCODES
+
+#define NUM_PROFILED_SEQUENCES 40
+#define TRIPLE_TABLE_SIZE (1 << 16)
+
+//- key: The three opcodes, packed into the low 24 bits.
+//- count: The number of times the triple was executed, or 0 if the
+//  entry is empty.
+typedef struct {
+  uint32_t key;
+  uint64_t count;
+} OpcodeTriple;
+
+static uint64_t opcode_pair_counts[256][256];
+static OpcodeTriple opcode_triple_counts[TRIPLE_TABLE_SIZE];
+static int profiled_opcodes[2] = {-1, -1};
+static int opcode_profile_registered = 0;
+
+static const char* profiled_opcode_name (int opcode){
+  return opcode_names[opcode] != NULL ? opcode_names[opcode] : "UNKNOWN";
+}
+
+static int compare_opcode_triples (const void* a, const void* b){
+  uint64_t ca = ((const OpcodeTriple*)a)->count;
+  uint64_t cb = ((const OpcodeTriple*)b)->count;
+  return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+static void print_opcode_profile (void){
+  init_opcode_names();
+
+  //The pairs are sorted using the same representation as the triples.
+  OpcodeTriple* pairs = (OpcodeTriple*)malloc(256 * 256 * sizeof(OpcodeTriple));
+  for(int i=0; i<256 * 256; i++){
+    pairs[i].key = i;
+    pairs[i].count = opcode_pair_counts[i >> 8][i & 0xFF];
+  }
+  qsort(pairs, 256 * 256, sizeof(OpcodeTriple), compare_opcode_triples);
+  fprintf(stderr, "Most frequent opcode pairs:\n");
+  for(int i=0; i<NUM_PROFILED_SEQUENCES && pairs[i].count > 0; i++)
+    fprintf(stderr, "%12" PRIu64 "  %s %s\n", pairs[i].count,
+            profiled_opcode_name(pairs[i].key >> 8),
+            profiled_opcode_name(pairs[i].key & 0xFF));
+  free(pairs);
+
+  qsort(opcode_triple_counts, TRIPLE_TABLE_SIZE, sizeof(OpcodeTriple), compare_opcode_triples);
+  fprintf(stderr, "Most frequent opcode triples:\n");
+  for(int i=0; i<NUM_PROFILED_SEQUENCES && opcode_triple_counts[i].count > 0; i++){
+    uint32_t key = opcode_triple_counts[i].key;
+    fprintf(stderr, "%12" PRIu64 "  %s %s %s\n", opcode_triple_counts[i].count,
+            profiled_opcode_name(key >> 16),
+            profiled_opcode_name((key >> 8) & 0xFF),
+            profiled_opcode_name(key & 0xFF));
+  }
+}
+
+static void profile_opcode (int opcode){
+  if(!opcode_profile_registered){
+    atexit(print_opcode_profile);
+    opcode_profile_registered = 1;
+  }
+  if(profiled_opcodes[1] >= 0)
+    opcode_pair_counts[profiled_opcodes[1]][opcode]++;
+  if(profiled_opcodes[0] >= 0){
+    //The triples are kept in an open-addressing table, since only a
+    //small fraction of them ever occur. Triples that no longer fit
+    //are dropped.
+    uint32_t key = (profiled_opcodes[0] << 16) | (profiled_opcodes[1] << 8) | opcode;
+    uint32_t slot = (key * 2654435761u) & (TRIPLE_TABLE_SIZE - 1);
+    for(int i=0; i<TRIPLE_TABLE_SIZE; i++){
+      OpcodeTriple* t = &opcode_triple_counts[(slot + i) & (TRIPLE_TABLE_SIZE - 1)];
+      if(t->count == 0) t->key = key;
+      if(t->key == key){
+        t->count++;
+        break;
+      }
+    }
+  }
+  profiled_opcodes[0] = profiled_opcodes[1];
+  profiled_opcodes[1] = opcode;
+}
+
+#define PROFILE_OPCODE(opcode) profile_opcode(opcode)
+#else
+#define PROFILE_OPCODE(opcode)
+#endif
+
+//============================================================
+//==================== DISPATCH MACROS =======================
+//============================================================
+//With GCC and Clang, each handler ends by jumping directly to the
+//handler of the next instruction through a table of label addresses.
+//Each handler then has its own indirect jump, which is predicted
+//much better than the single jump of the switch. Other compilers use
+//the switch, which can also be forced by defining CVM_SWITCH_DISPATCH.
+
+#if defined(__GNUC__) && !defined(CVM_SWITCH_DISPATCH)
+  #define CVM_THREADED_DISPATCH
+#endif
+
+#ifdef CVM_THREADED_DISPATCH
+  #define TARGET(op) case op : TARGET_##op :
+  #define NEXT_INSTRUCTION() \
+    { pc0 = pc; \
+      W1 = PC_INT(); \
+      opcode = W1 & 0xFF; \
+      PROFILE_OPCODE(opcode); \
+      goto *dispatch_table[opcode]; }
+#else
+  #define TARGET(op) case op :
+  #define NEXT_INSTRUCTION() continue
+#endif
+
 #define DECODE_TGTS() \
   uint32_t n = PC_INT(); \
   for(int i=0; i<n; i++){ \
@@ -633,6 +761,10 @@ void init_opcode_names () {
 #define INIT_CONSTS_FN 2
 #define EXECUTE_TOPLEVEL_COMMAND_FN 3
 
+//Objects of at least this many bytes (including the header) are
+//allocated in the large-object space.
+#define LARGE_OBJECT_THRESHOLD (64 * 1024)
+
 #define BOOLREF(x) (((x) << 3) + MARKER_TAG_BITS)
 
 #define SYSTEM_RETURN_STUB -2
@@ -664,6 +796,12 @@ typedef struct{
   void* liveness_trackers;
   void* iterate_roots;
   void* iterate_references_in_stack_frames;
+  uint64_t* dirty_cards;
+  uint64_t* dirty_cards_base;
+  void* large_objects;
+  void* dead_trackers;
+  uint64_t last_busy_time;
+  uint64_t touched_end;
 } Heap;
 
 //The first fields in VMState are used by the core library
@@ -686,6 +824,7 @@ typedef struct{
   //Interpreted Mode Tables
   char* instructions;          //(Permanent State)
   void** trie_table;           //(Permanent State)
+  uint64_t dispatch_epoch;     //(Permanent State)
 } VMState;
 
 typedef struct{
@@ -734,6 +873,11 @@ static inline void set_mark (const void* p, uint64_t* bitset_base) {
 static inline void clear_mark (const void* p, uint64_t* bitset_base) {
   *bit_address(p, bitset_base) &= ~bit_mask(p);
 }
+//A card spans the heap bytes covered by one long of the bitset.
+static inline void set_dirty_card (const void* p, uint64_t* dirty_cards_base) {
+  uint64_t card_index = bit_index(p) >> LOG_BITS_IN_LONG;
+  dirty_cards_base[card_index >> LOG_BITS_IN_LONG] |= 1ULL << (card_index & (BITS_IN_LONG - 1));
+}
 static inline void set_bit (uint64_t bit_index, uint64_t* bitset_base) {
   uint64_t word_index = bit_index >> 6;
   uint64_t word_bit_index = bit_index & 63;
@@ -778,10 +922,61 @@ void* call_collect_stack_trace (VMState* vms, uint64_t stack);
 void c_trampoline (void* fptr, void* argbuffer, void* retbuffer);
 uint64_t lowest_zero_bit_count (uint64_t x);
 
+//============================================================
+//===================== Inline Caches ========================
+//============================================================
+//Each dispatch site has an inline cache that remembers the results
+//of its most recent dispatches. An entry is keyed on the types of
+//the registers that were examined while walking the trie table, and
+//is only valid in the dispatch epoch in which it was filled. The
+//epoch is advanced whenever loading code changes an existing dispatch
+//table, which empties all caches at once. The epoch is 1 by the time
+//any code runs, so a zeroed cache is empty.
+
+#define DISPATCH_CACHE_SIZE 4
+#define MAX_CACHED_DISPATCH_ARGS 2
+
+//The caches of the interpreter are stored in the instruction stream,
+//which is only aligned to 4 bytes.
+#pragma pack(push, 4)
+
+//- epoch: The dispatch epoch in which the entry was filled.
+//- value: The result of the dispatch.
+//- num_args: The number of registers that were examined.
+//- args: The index of each register that was examined.
+//- types: The type of each register that was examined.
+typedef struct {
+  uint64_t epoch;
+  int32_t value;
+  uint8_t num_args;
+  uint8_t args[MAX_CACHED_DISPATCH_ARGS];
+  int32_t types[MAX_CACHED_DISPATCH_ARGS];
+} DispatchCacheEntry;
+
+//- uncached_epoch: The dispatch epoch in which a dispatch at this site
+//  examined too many registers to be cached. The site then reads the
+//  dispatch table directly until the epoch changes.
+//- next: The entry that is replaced on the next miss.
+typedef struct {
+  uint64_t uncached_epoch;
+  uint32_t next;
+  DispatchCacheEntry entries[DISPATCH_CACHE_SIZE];
+} DispatchCache;
+
+#pragma pack(pop)
+
+//The interpreter reserves DISPATCH_CACHE_WORDS instruction words
+//after each dispatch instruction for its cache. This must match
+//DISPATCH-CACHE-WORDS in vm-opcodes.stanza.
+#define DISPATCH_CACHE_WORDS 27
+_Static_assert(sizeof(DispatchCache) == DISPATCH_CACHE_WORDS * 4,
+               "DispatchCache does not match its reserved instruction words.");
+
 //============================================================
 //=================== Forward Declarations ===================
 //============================================================
 int read_dispatch_table (VMState* vms, int format);
+int read_cached_dispatch_table (DispatchCache* cache, VMState* vms, int format);
 
 //============================================================
 //==================== Write Barrier =========================
@@ -792,6 +987,7 @@ static inline void barriered_store (const VMState* vms, uint64_t* address, uint6
   // First store the value
   *address = value;
   set_mark(address, vms->heap.bitset_base);
+  set_dirty_card(address, vms->heap.dirty_cards_base);
 }
 
 //============================================================
@@ -854,16 +1050,278 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
   //Debug
   //init_iprint();
 
+  //Handler of each opcode, for threaded dispatch.
+#ifdef CVM_THREADED_DISPATCH
+  //Every slot defaults to invalid_opcode before the opcodes override it.
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Woverride-init"
+  static void* dispatch_table[256] = {
+    [0 ... 255] = &&invalid_opcode,
+    [SET_OPCODE_LOCAL] = &&TARGET_SET_OPCODE_LOCAL,
+    [SET_OPCODE_UNSIGNED] = &&TARGET_SET_OPCODE_UNSIGNED,
+    [SET_OPCODE_SIGNED] = &&TARGET_SET_OPCODE_SIGNED,
+    [SET_OPCODE_CODE] = &&TARGET_SET_OPCODE_CODE,
+    [SET_OPCODE_GLOBAL] = &&TARGET_SET_OPCODE_GLOBAL,
+    [SET_OPCODE_DATA] = &&TARGET_SET_OPCODE_DATA,
+    [SET_OPCODE_CONST] = &&TARGET_SET_OPCODE_CONST,
+    [SET_OPCODE_WIDE] = &&TARGET_SET_OPCODE_WIDE,
+    [SET_REG_OPCODE_LOCAL] = &&TARGET_SET_REG_OPCODE_LOCAL,
+    [SET_REG_OPCODE_UNSIGNED] = &&TARGET_SET_REG_OPCODE_UNSIGNED,
+    [SET_REG_OPCODE_SIGNED] = &&TARGET_SET_REG_OPCODE_SIGNED,
+    [SET_REG_OPCODE_CODE] = &&TARGET_SET_REG_OPCODE_CODE,
+    [SET_REG_OPCODE_GLOBAL] = &&TARGET_SET_REG_OPCODE_GLOBAL,
+    [SET_REG_OPCODE_DATA] = &&TARGET_SET_REG_OPCODE_DATA,
+    [SET_REG_OPCODE_CONST] = &&TARGET_SET_REG_OPCODE_CONST,
+    [SET_REG_OPCODE_WIDE] = &&TARGET_SET_REG_OPCODE_WIDE,
+    [GET_REG_OPCODE] = &&TARGET_GET_REG_OPCODE,
+    [CALL_OPCODE_LOCAL] = &&TARGET_CALL_OPCODE_LOCAL,
+    [CALL_OPCODE_CODE] = &&TARGET_CALL_OPCODE_CODE,
+    [CALL_CLOSURE_OPCODE] = &&TARGET_CALL_CLOSURE_OPCODE,
+    [TCALL_OPCODE_LOCAL] = &&TARGET_TCALL_OPCODE_LOCAL,
+    [TCALL_OPCODE_CODE] = &&TARGET_TCALL_OPCODE_CODE,
+    [TCALL_CLOSURE_OPCODE] = &&TARGET_TCALL_CLOSURE_OPCODE,
+    [CALLC_OPCODE_LOCAL] = &&TARGET_CALLC_OPCODE_LOCAL,
+    [CALLC_OPCODE_WIDE] = &&TARGET_CALLC_OPCODE_WIDE,
+    [POP_FRAME_OPCODE] = &&TARGET_POP_FRAME_OPCODE,
+    [LIVE_OPCODE] = &&TARGET_LIVE_OPCODE,
+    [ENTER_STACK_OPCODE] = &&TARGET_ENTER_STACK_OPCODE,
+    [YIELD_OPCODE] = &&TARGET_YIELD_OPCODE,
+    [RETURN_OPCODE] = &&TARGET_RETURN_OPCODE,
+    [DUMP_OPCODE] = &&TARGET_DUMP_OPCODE,
+    [INT_ADD_OPCODE] = &&TARGET_INT_ADD_OPCODE,
+    [INT_SUB_OPCODE] = &&TARGET_INT_SUB_OPCODE,
+    [INT_MUL_OPCODE] = &&TARGET_INT_MUL_OPCODE,
+    [INT_DIV_OPCODE] = &&TARGET_INT_DIV_OPCODE,
+    [INT_MOD_OPCODE] = &&TARGET_INT_MOD_OPCODE,
+    [INT_AND_OPCODE] = &&TARGET_INT_AND_OPCODE,
+    [INT_OR_OPCODE] = &&TARGET_INT_OR_OPCODE,
+    [INT_XOR_OPCODE] = &&TARGET_INT_XOR_OPCODE,
+    [INT_SHL_OPCODE] = &&TARGET_INT_SHL_OPCODE,
+    [INT_SHR_OPCODE] = &&TARGET_INT_SHR_OPCODE,
+    [INT_ASHR_OPCODE] = &&TARGET_INT_ASHR_OPCODE,
+    [INT_LT_OPCODE] = &&TARGET_INT_LT_OPCODE,
+    [INT_GT_OPCODE] = &&TARGET_INT_GT_OPCODE,
+    [INT_LE_OPCODE] = &&TARGET_INT_LE_OPCODE,
+    [INT_GE_OPCODE] = &&TARGET_INT_GE_OPCODE,
+    [REF_EQ_OPCODE] = &&TARGET_REF_EQ_OPCODE,
+    [EQ_OPCODE_REF] = &&TARGET_EQ_OPCODE_REF,
+    [EQ_OPCODE_BYTE] = &&TARGET_EQ_OPCODE_BYTE,
+    [EQ_OPCODE_INT] = &&TARGET_EQ_OPCODE_INT,
+    [EQ_OPCODE_LONG] = &&TARGET_EQ_OPCODE_LONG,
+    [EQ_OPCODE_FLOAT] = &&TARGET_EQ_OPCODE_FLOAT,
+    [EQ_OPCODE_DOUBLE] = &&TARGET_EQ_OPCODE_DOUBLE,
+    [REF_NE_OPCODE] = &&TARGET_REF_NE_OPCODE,
+    [NE_OPCODE_REF] = &&TARGET_NE_OPCODE_REF,
+    [NE_OPCODE_BYTE] = &&TARGET_NE_OPCODE_BYTE,
+    [NE_OPCODE_INT] = &&TARGET_NE_OPCODE_INT,
+    [NE_OPCODE_LONG] = &&TARGET_NE_OPCODE_LONG,
+    [NE_OPCODE_FLOAT] = &&TARGET_NE_OPCODE_FLOAT,
+    [NE_OPCODE_DOUBLE] = &&TARGET_NE_OPCODE_DOUBLE,
+    [ADD_OPCODE_BYTE] = &&TARGET_ADD_OPCODE_BYTE,
+    [ADD_OPCODE_INT] = &&TARGET_ADD_OPCODE_INT,
+    [ADD_OPCODE_LONG] = &&TARGET_ADD_OPCODE_LONG,
+    [ADD_OPCODE_FLOAT] = &&TARGET_ADD_OPCODE_FLOAT,
+    [ADD_OPCODE_DOUBLE] = &&TARGET_ADD_OPCODE_DOUBLE,
+    [SUB_OPCODE_BYTE] = &&TARGET_SUB_OPCODE_BYTE,
+    [SUB_OPCODE_INT] = &&TARGET_SUB_OPCODE_INT,
+    [SUB_OPCODE_LONG] = &&TARGET_SUB_OPCODE_LONG,
+    [SUB_OPCODE_FLOAT] = &&TARGET_SUB_OPCODE_FLOAT,
+    [SUB_OPCODE_DOUBLE] = &&TARGET_SUB_OPCODE_DOUBLE,
+    [MUL_OPCODE_BYTE] = &&TARGET_MUL_OPCODE_BYTE,
+    [MUL_OPCODE_INT] = &&TARGET_MUL_OPCODE_INT,
+    [MUL_OPCODE_LONG] = &&TARGET_MUL_OPCODE_LONG,
+    [MUL_OPCODE_FLOAT] = &&TARGET_MUL_OPCODE_FLOAT,
+    [MUL_OPCODE_DOUBLE] = &&TARGET_MUL_OPCODE_DOUBLE,
+    [DIV_OPCODE_BYTE] = &&TARGET_DIV_OPCODE_BYTE,
+    [DIV_OPCODE_INT] = &&TARGET_DIV_OPCODE_INT,
+    [DIV_OPCODE_LONG] = &&TARGET_DIV_OPCODE_LONG,
+    [DIV_OPCODE_FLOAT] = &&TARGET_DIV_OPCODE_FLOAT,
+    [DIV_OPCODE_DOUBLE] = &&TARGET_DIV_OPCODE_DOUBLE,
+    [MOD_OPCODE_BYTE] = &&TARGET_MOD_OPCODE_BYTE,
+    [MOD_OPCODE_INT] = &&TARGET_MOD_OPCODE_INT,
+    [MOD_OPCODE_LONG] = &&TARGET_MOD_OPCODE_LONG,
+    [AND_OPCODE_BYTE] = &&TARGET_AND_OPCODE_BYTE,
+    [AND_OPCODE_INT] = &&TARGET_AND_OPCODE_INT,
+    [AND_OPCODE_LONG] = &&TARGET_AND_OPCODE_LONG,
+    [OR_OPCODE_BYTE] = &&TARGET_OR_OPCODE_BYTE,
+    [OR_OPCODE_INT] = &&TARGET_OR_OPCODE_INT,
+    [OR_OPCODE_LONG] = &&TARGET_OR_OPCODE_LONG,
+    [XOR_OPCODE_BYTE] = &&TARGET_XOR_OPCODE_BYTE,
+    [XOR_OPCODE_INT] = &&TARGET_XOR_OPCODE_INT,
+    [XOR_OPCODE_LONG] = &&TARGET_XOR_OPCODE_LONG,
+    [SHL_OPCODE_BYTE] = &&TARGET_SHL_OPCODE_BYTE,
+    [SHL_OPCODE_INT] = &&TARGET_SHL_OPCODE_INT,
+    [SHL_OPCODE_LONG] = &&TARGET_SHL_OPCODE_LONG,
+    [SHR_OPCODE_BYTE] = &&TARGET_SHR_OPCODE_BYTE,
+    [SHR_OPCODE_INT] = &&TARGET_SHR_OPCODE_INT,
+    [SHR_OPCODE_LONG] = &&TARGET_SHR_OPCODE_LONG,
+    [ASHR_OPCODE_INT] = &&TARGET_ASHR_OPCODE_INT,
+    [ASHR_OPCODE_LONG] = &&TARGET_ASHR_OPCODE_LONG,
+    [LT_OPCODE_INT] = &&TARGET_LT_OPCODE_INT,
+    [LT_OPCODE_LONG] = &&TARGET_LT_OPCODE_LONG,
+    [LT_OPCODE_FLOAT] = &&TARGET_LT_OPCODE_FLOAT,
+    [LT_OPCODE_DOUBLE] = &&TARGET_LT_OPCODE_DOUBLE,
+    [GT_OPCODE_INT] = &&TARGET_GT_OPCODE_INT,
+    [GT_OPCODE_LONG] = &&TARGET_GT_OPCODE_LONG,
+    [GT_OPCODE_FLOAT] = &&TARGET_GT_OPCODE_FLOAT,
+    [GT_OPCODE_DOUBLE] = &&TARGET_GT_OPCODE_DOUBLE,
+    [LE_OPCODE_INT] = &&TARGET_LE_OPCODE_INT,
+    [LE_OPCODE_LONG] = &&TARGET_LE_OPCODE_LONG,
+    [LE_OPCODE_FLOAT] = &&TARGET_LE_OPCODE_FLOAT,
+    [LE_OPCODE_DOUBLE] = &&TARGET_LE_OPCODE_DOUBLE,
+    [GE_OPCODE_INT] = &&TARGET_GE_OPCODE_INT,
+    [GE_OPCODE_LONG] = &&TARGET_GE_OPCODE_LONG,
+    [GE_OPCODE_FLOAT] = &&TARGET_GE_OPCODE_FLOAT,
+    [GE_OPCODE_DOUBLE] = &&TARGET_GE_OPCODE_DOUBLE,
+    [ULE_OPCODE_BYTE] = &&TARGET_ULE_OPCODE_BYTE,
+    [ULE_OPCODE_INT] = &&TARGET_ULE_OPCODE_INT,
+    [ULE_OPCODE_LONG] = &&TARGET_ULE_OPCODE_LONG,
+    [ULT_OPCODE_BYTE] = &&TARGET_ULT_OPCODE_BYTE,
+    [ULT_OPCODE_INT] = &&TARGET_ULT_OPCODE_INT,
+    [ULT_OPCODE_LONG] = &&TARGET_ULT_OPCODE_LONG,
+    [UGT_OPCODE_BYTE] = &&TARGET_UGT_OPCODE_BYTE,
+    [UGT_OPCODE_INT] = &&TARGET_UGT_OPCODE_INT,
+    [UGT_OPCODE_LONG] = &&TARGET_UGT_OPCODE_LONG,
+    [UGE_OPCODE_BYTE] = &&TARGET_UGE_OPCODE_BYTE,
+    [UGE_OPCODE_INT] = &&TARGET_UGE_OPCODE_INT,
+    [UGE_OPCODE_LONG] = &&TARGET_UGE_OPCODE_LONG,
+    [INT_NOT_OPCODE] = &&TARGET_INT_NOT_OPCODE,
+    [INT_NEG_OPCODE] = &&TARGET_INT_NEG_OPCODE,
+    [NOT_OPCODE_BYTE] = &&TARGET_NOT_OPCODE_BYTE,
+    [NOT_OPCODE_INT] = &&TARGET_NOT_OPCODE_INT,
+    [NOT_OPCODE_LONG] = &&TARGET_NOT_OPCODE_LONG,
+    [NEG_OPCODE_INT] = &&TARGET_NEG_OPCODE_INT,
+    [NEG_OPCODE_LONG] = &&TARGET_NEG_OPCODE_LONG,
+    [NEG_OPCODE_FLOAT] = &&TARGET_NEG_OPCODE_FLOAT,
+    [NEG_OPCODE_DOUBLE] = &&TARGET_NEG_OPCODE_DOUBLE,
+    [DEREF_OPCODE] = &&TARGET_DEREF_OPCODE,
+    [TYPEOF_OPCODE] = &&TARGET_TYPEOF_OPCODE,
+    [JUMP_SET_OPCODE] = &&TARGET_JUMP_SET_OPCODE,
+    [JUMP_TAGBITS_OPCODE] = &&TARGET_JUMP_TAGBITS_OPCODE,
+    [JUMP_TAGWORD_OPCODE] = &&TARGET_JUMP_TAGWORD_OPCODE,
+    [GOTO_OPCODE] = &&TARGET_GOTO_OPCODE,
+    [CONV_OPCODE_BYTE_FLOAT] = &&TARGET_CONV_OPCODE_BYTE_FLOAT,
+    [CONV_OPCODE_BYTE_DOUBLE] = &&TARGET_CONV_OPCODE_BYTE_DOUBLE,
+    [CONV_OPCODE_INT_BYTE] = &&TARGET_CONV_OPCODE_INT_BYTE,
+    [CONV_OPCODE_INT_FLOAT] = &&TARGET_CONV_OPCODE_INT_FLOAT,
+    [CONV_OPCODE_INT_DOUBLE] = &&TARGET_CONV_OPCODE_INT_DOUBLE,
+    [CONV_OPCODE_LONG_BYTE] = &&TARGET_CONV_OPCODE_LONG_BYTE,
+    [CONV_OPCODE_LONG_INT] = &&TARGET_CONV_OPCODE_LONG_INT,
+    [CONV_OPCODE_LONG_FLOAT] = &&TARGET_CONV_OPCODE_LONG_FLOAT,
+    [CONV_OPCODE_LONG_DOUBLE] = &&TARGET_CONV_OPCODE_LONG_DOUBLE,
+    [CONV_OPCODE_FLOAT_BYTE] = &&TARGET_CONV_OPCODE_FLOAT_BYTE,
+    [CONV_OPCODE_FLOAT_INT] = &&TARGET_CONV_OPCODE_FLOAT_INT,
+    [CONV_OPCODE_FLOAT_LONG] = &&TARGET_CONV_OPCODE_FLOAT_LONG,
+    [CONV_OPCODE_FLOAT_DOUBLE] = &&TARGET_CONV_OPCODE_FLOAT_DOUBLE,
+    [CONV_OPCODE_DOUBLE_BYTE] = &&TARGET_CONV_OPCODE_DOUBLE_BYTE,
+    [CONV_OPCODE_DOUBLE_INT] = &&TARGET_CONV_OPCODE_DOUBLE_INT,
+    [CONV_OPCODE_DOUBLE_LONG] = &&TARGET_CONV_OPCODE_DOUBLE_LONG,
+    [CONV_OPCODE_DOUBLE_FLOAT] = &&TARGET_CONV_OPCODE_DOUBLE_FLOAT,
+    [DETAG_OPCODE] = &&TARGET_DETAG_OPCODE,
+    [TAG_OPCODE_BYTE] = &&TARGET_TAG_OPCODE_BYTE,
+    [TAG_OPCODE_CHAR] = &&TARGET_TAG_OPCODE_CHAR,
+    [TAG_OPCODE_INT] = &&TARGET_TAG_OPCODE_INT,
+    [TAG_OPCODE_FLOAT] = &&TARGET_TAG_OPCODE_FLOAT,
+    [STORE_OPCODE_1] = &&TARGET_STORE_OPCODE_1,
+    [STORE_OPCODE_4] = &&TARGET_STORE_OPCODE_4,
+    [STORE_OPCODE_8] = &&TARGET_STORE_OPCODE_8,
+    [STORE_OPCODE_1_VAR_OFFSET] = &&TARGET_STORE_OPCODE_1_VAR_OFFSET,
+    [STORE_OPCODE_4_VAR_OFFSET] = &&TARGET_STORE_OPCODE_4_VAR_OFFSET,
+    [STORE_OPCODE_8_VAR_OFFSET] = &&TARGET_STORE_OPCODE_8_VAR_OFFSET,
+    [STORE_WITH_BARRIER_OPCODE] = &&TARGET_STORE_WITH_BARRIER_OPCODE,
+    [STORE_WITH_BARRIER_OPCODE_VAR_OFFSET] = &&TARGET_STORE_WITH_BARRIER_OPCODE_VAR_OFFSET,
+    [SET_REG2_OPCODE_LOCAL] = &&TARGET_SET_REG2_OPCODE_LOCAL,
+    [RETURN_OPCODE_LOCAL] = &&TARGET_RETURN_OPCODE_LOCAL,
+    [POP_FRAME_GET_REG_OPCODE] = &&TARGET_POP_FRAME_GET_REG_OPCODE,
+    [LOAD_OPCODE_1] = &&TARGET_LOAD_OPCODE_1,
+    [LOAD_OPCODE_4] = &&TARGET_LOAD_OPCODE_4,
+    [LOAD_OPCODE_8] = &&TARGET_LOAD_OPCODE_8,
+    [LOAD_OPCODE_1_VAR_OFFSET] = &&TARGET_LOAD_OPCODE_1_VAR_OFFSET,
+    [LOAD_OPCODE_4_VAR_OFFSET] = &&TARGET_LOAD_OPCODE_4_VAR_OFFSET,
+    [LOAD_OPCODE_8_VAR_OFFSET] = &&TARGET_LOAD_OPCODE_8_VAR_OFFSET,
+    [RESERVE_OPCODE_LOCAL] = &&TARGET_RESERVE_OPCODE_LOCAL,
+    [RESERVE_OPCODE_CONST] = &&TARGET_RESERVE_OPCODE_CONST,
+    [ALLOC_OPCODE_CONST] = &&TARGET_ALLOC_OPCODE_CONST,
+    [ALLOC_OPCODE_LOCAL] = &&TARGET_ALLOC_OPCODE_LOCAL,
+    [GC_OPCODE] = &&TARGET_GC_OPCODE,
+    [PRINT_STACK_TRACE_OPCODE] = &&TARGET_PRINT_STACK_TRACE_OPCODE,
+    [COLLECT_STACK_TRACE_OPCODE] = &&TARGET_COLLECT_STACK_TRACE_OPCODE,
+    [FLUSH_VM_OPCODE] = &&TARGET_FLUSH_VM_OPCODE,
+    [C_RSP_OPCODE] = &&TARGET_C_RSP_OPCODE,
+    [JUMP_INT_LT_OPCODE] = &&TARGET_JUMP_INT_LT_OPCODE,
+    [JUMP_INT_GT_OPCODE] = &&TARGET_JUMP_INT_GT_OPCODE,
+    [JUMP_INT_LE_OPCODE] = &&TARGET_JUMP_INT_LE_OPCODE,
+    [JUMP_INT_GE_OPCODE] = &&TARGET_JUMP_INT_GE_OPCODE,
+    [JUMP_EQ_OPCODE_REF] = &&TARGET_JUMP_EQ_OPCODE_REF,
+    [JUMP_EQ_OPCODE_BYTE] = &&TARGET_JUMP_EQ_OPCODE_BYTE,
+    [JUMP_EQ_OPCODE_INT] = &&TARGET_JUMP_EQ_OPCODE_INT,
+    [JUMP_EQ_OPCODE_LONG] = &&TARGET_JUMP_EQ_OPCODE_LONG,
+    [JUMP_EQ_OPCODE_FLOAT] = &&TARGET_JUMP_EQ_OPCODE_FLOAT,
+    [JUMP_EQ_OPCODE_DOUBLE] = &&TARGET_JUMP_EQ_OPCODE_DOUBLE,
+    [JUMP_NE_OPCODE_REF] = &&TARGET_JUMP_NE_OPCODE_REF,
+    [JUMP_NE_OPCODE_BYTE] = &&TARGET_JUMP_NE_OPCODE_BYTE,
+    [JUMP_NE_OPCODE_INT] = &&TARGET_JUMP_NE_OPCODE_INT,
+    [JUMP_NE_OPCODE_LONG] = &&TARGET_JUMP_NE_OPCODE_LONG,
+    [JUMP_NE_OPCODE_FLOAT] = &&TARGET_JUMP_NE_OPCODE_FLOAT,
+    [JUMP_NE_OPCODE_DOUBLE] = &&TARGET_JUMP_NE_OPCODE_DOUBLE,
+    [JUMP_LT_OPCODE_INT] = &&TARGET_JUMP_LT_OPCODE_INT,
+    [JUMP_LT_OPCODE_LONG] = &&TARGET_JUMP_LT_OPCODE_LONG,
+    [JUMP_LT_OPCODE_FLOAT] = &&TARGET_JUMP_LT_OPCODE_FLOAT,
+    [JUMP_LT_OPCODE_DOUBLE] = &&TARGET_JUMP_LT_OPCODE_DOUBLE,
+    [JUMP_GT_OPCODE_INT] = &&TARGET_JUMP_GT_OPCODE_INT,
+    [JUMP_GT_OPCODE_LONG] = &&TARGET_JUMP_GT_OPCODE_LONG,
+    [JUMP_GT_OPCODE_FLOAT] = &&TARGET_JUMP_GT_OPCODE_FLOAT,
+    [JUMP_GT_OPCODE_DOUBLE] = &&TARGET_JUMP_GT_OPCODE_DOUBLE,
+    [JUMP_LE_OPCODE_INT] = &&TARGET_JUMP_LE_OPCODE_INT,
+    [JUMP_LE_OPCODE_LONG] = &&TARGET_JUMP_LE_OPCODE_LONG,
+    [JUMP_LE_OPCODE_FLOAT] = &&TARGET_JUMP_LE_OPCODE_FLOAT,
+    [JUMP_LE_OPCODE_DOUBLE] = &&TARGET_JUMP_LE_OPCODE_DOUBLE,
+    [JUMP_GE_OPCODE_INT] = &&TARGET_JUMP_GE_OPCODE_INT,
+    [JUMP_GE_OPCODE_LONG] = &&TARGET_JUMP_GE_OPCODE_LONG,
+    [JUMP_GE_OPCODE_FLOAT] = &&TARGET_JUMP_GE_OPCODE_FLOAT,
+    [JUMP_GE_OPCODE_DOUBLE] = &&TARGET_JUMP_GE_OPCODE_DOUBLE,
+    [JUMP_ULE_OPCODE_BYTE] = &&TARGET_JUMP_ULE_OPCODE_BYTE,
+    [JUMP_ULE_OPCODE_INT] = &&TARGET_JUMP_ULE_OPCODE_INT,
+    [JUMP_ULE_OPCODE_LONG] = &&TARGET_JUMP_ULE_OPCODE_LONG,
+    [JUMP_ULT_OPCODE_BYTE] = &&TARGET_JUMP_ULT_OPCODE_BYTE,
+    [JUMP_ULT_OPCODE_INT] = &&TARGET_JUMP_ULT_OPCODE_INT,
+    [JUMP_ULT_OPCODE_LONG] = &&TARGET_JUMP_ULT_OPCODE_LONG,
+    [JUMP_UGE_OPCODE_BYTE] = &&TARGET_JUMP_UGE_OPCODE_BYTE,
+    [JUMP_UGE_OPCODE_INT] = &&TARGET_JUMP_UGE_OPCODE_INT,
+    [JUMP_UGE_OPCODE_LONG] = &&TARGET_JUMP_UGE_OPCODE_LONG,
+    [JUMP_UGT_OPCODE_BYTE] = &&TARGET_JUMP_UGT_OPCODE_BYTE,
+    [JUMP_UGT_OPCODE_INT] = &&TARGET_JUMP_UGT_OPCODE_INT,
+    [JUMP_UGT_OPCODE_LONG] = &&TARGET_JUMP_UGT_OPCODE_LONG,
+    [DISPATCH_OPCODE] = &&TARGET_DISPATCH_OPCODE,
+    [DISPATCH_METHOD_OPCODE] = &&TARGET_DISPATCH_METHOD_OPCODE,
+    [JUMP_REG_OPCODE] = &&TARGET_JUMP_REG_OPCODE,
+    [FNENTRY_OPCODE] = &&TARGET_FNENTRY_OPCODE,
+    [LOWEST_ZERO_BIT_COUNT_OPCODE_LONG] = &&TARGET_LOWEST_ZERO_BIT_COUNT_OPCODE_LONG,
+    [SET_BIT_OPCODE] = &&TARGET_SET_BIT_OPCODE,
+    [CLEAR_BIT_OPCODE] = &&TARGET_CLEAR_BIT_OPCODE,
+    [TEST_BIT_OPCODE] = &&TARGET_TEST_BIT_OPCODE,
+    [TEST_AND_SET_BIT_OPCODE] = &&TARGET_TEST_AND_SET_BIT_OPCODE,
+    [TEST_AND_CLEAR_BIT_OPCODE] = &&TARGET_TEST_AND_CLEAR_BIT_OPCODE,
+  };
+  #pragma GCC diagnostic pop
+#endif
+
+  //Current instruction.
+  //The pre-decode PC is saved because jump offsets are relative to
+  //pre-decode PC.
+  char* pc0;
+  uint32_t W1;
+  int opcode;
+
   //Repl Loop
   while(1){
     //icounter++;
     //int iprint = icounter >= iprint_start && icounter <= iprint_end && icounter % iprint_step == 0;
 
-    //Save pre-decode PC because jump offsets are relative to
-    //pre-decode PC.
-    char* pc0 = pc;
-    uint32_t W1 = PC_INT();
-    int opcode = W1 & 0xFF;
+    pc0 = pc;
+    W1 = PC_INT();
+    opcode = W1 & 0xFF;
+    PROFILE_OPCODE(opcode);
 
     //uint64_t curtime = current_time_ms();
     //if(last_opcode >= 0)
@@ -872,114 +1330,120 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
     //last_time = curtime;
 
     switch(opcode){
-    case SET_OPCODE_LOCAL : {
+    TARGET(SET_OPCODE_LOCAL) {
       DECODE_C();
       SET_LOCAL(y, LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_OPCODE_UNSIGNED : {
+    TARGET(SET_OPCODE_UNSIGNED) {
       DECODE_C();
       SET_LOCAL(y, (uint64_t)value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_OPCODE_SIGNED : {
+    TARGET(SET_OPCODE_SIGNED) {
       DECODE_C();
       SET_LOCAL(y, (int64_t)(int32_t)value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_OPCODE_CODE : {
+    TARGET(SET_OPCODE_CODE) {
       DECODE_C();
       SET_LOCAL(y, value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_OPCODE_GLOBAL : {
+    TARGET(SET_OPCODE_GLOBAL) {
       DECODE_C();
       char* address = global_mem + global_offsets[value];
       SET_LOCAL(y, (uint64_t)address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_OPCODE_DATA : {
+    TARGET(SET_OPCODE_DATA) {
       DECODE_C();
       char* address = data_mem + 8 * data_offsets[value];
       SET_LOCAL(y, (uint64_t)address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_OPCODE_CONST : {
+    TARGET(SET_OPCODE_CONST) {
       DECODE_C();
       SET_LOCAL(y, const_table[value]);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_OPCODE_WIDE : {
+    TARGET(SET_OPCODE_WIDE) {
       DECODE_D();
       SET_LOCAL(x, value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_LOCAL : {
+    TARGET(SET_REG_OPCODE_LOCAL) {
       DECODE_C();
       SET_REG(y, LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_UNSIGNED : {
+    TARGET(SET_REG_OPCODE_UNSIGNED) {
       DECODE_C();
       SET_REG(y, (uint64_t)value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_SIGNED : {
+    TARGET(SET_REG_OPCODE_SIGNED) {
       DECODE_C();
       SET_REG(y, (int64_t)(int32_t)value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_CODE : {
+    TARGET(SET_REG_OPCODE_CODE) {
       DECODE_C();
       SET_REG(y, value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_GLOBAL : {
+    TARGET(SET_REG_OPCODE_GLOBAL) {
       DECODE_C();
       char* address = global_mem + global_offsets[value];
       SET_REG(y, (uint64_t)address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_DATA : {
+    TARGET(SET_REG_OPCODE_DATA) {
       DECODE_C();
       char* address = data_mem + 8 * data_offsets[value];
       SET_REG(y, (uint64_t)address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_CONST : {
+    TARGET(SET_REG_OPCODE_CONST) {
       DECODE_C();
       SET_REG(y, const_table[value]);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_REG_OPCODE_WIDE : {
+    TARGET(SET_REG_OPCODE_WIDE) {
       DECODE_D();
       SET_REG(x, value);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GET_REG_OPCODE : {
+    TARGET(GET_REG_OPCODE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, registers[value]);
-      continue;
+      NEXT_INSTRUCTION();
+    }
+    TARGET(SET_REG2_OPCODE_LOCAL) {
+      DECODE_C();
+      SET_REG(y, LOCAL(x));
+      SET_REG(y + 1, LOCAL(value));
+      NEXT_INSTRUCTION();
     }
-    case CALL_OPCODE_LOCAL : {
+    TARGET(CALL_OPCODE_LOCAL) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = LOCAL(value);
       uint64_t fpos = code_offsets[fid];
       PUSH_FRAME(num_locals);
       pc = instructions + fpos;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CALL_OPCODE_CODE : {
+    TARGET(CALL_OPCODE_CODE) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = value;
       uint64_t fpos = code_offsets[fid];
       PUSH_FRAME(num_locals);
       pc = instructions + fpos;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CALL_CLOSURE_OPCODE : {
+    TARGET(CALL_CLOSURE_OPCODE) {
       DECODE_C();
       int num_locals = y;
       Function* clo = (Function*)(LOCAL(value) - REF_TAG_BITS + 8);
@@ -987,33 +1451,33 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       uint64_t fpos = code_offsets[fid];
       PUSH_FRAME(num_locals);
       pc = instructions + fpos;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TCALL_OPCODE_LOCAL : {
+    TARGET(TCALL_OPCODE_LOCAL) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = LOCAL(value);
       uint64_t fpos = code_offsets[fid];
       pc = instructions + fpos;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TCALL_OPCODE_CODE : {
+    TARGET(TCALL_OPCODE_CODE) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = value;
       uint64_t fpos = code_offsets[fid];
       pc = instructions + fpos;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TCALL_CLOSURE_OPCODE : {
+    TARGET(TCALL_CLOSURE_OPCODE) {
       DECODE_A_UNSIGNED();
       Function* clo = (Function*)(LOCAL(value) - REF_TAG_BITS + 8);
       uint64_t fid = clo->code;
       uint64_t fpos = code_offsets[fid];
       pc = instructions + fpos;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CALLC_OPCODE_LOCAL : {
+    TARGET(CALLC_OPCODE_LOCAL) {
       DECODE_C();
       void* faddr = (void*)LOCAL(value);
       int num_locals = y;
@@ -1023,9 +1487,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       RESTORE_STATE();
       pc = instructions + stack_pointer->returnpc;
       POP_FRAME(num_locals);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CALLC_OPCODE_WIDE : {
+    TARGET(CALLC_OPCODE_WIDE) {
       DECODE_D();
       void* faddr = (void*)(uint64_t)value;
       int num_locals = x;
@@ -1035,20 +1499,27 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       RESTORE_STATE();
       pc = instructions + stack_pointer->returnpc;
       POP_FRAME(num_locals);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case POP_FRAME_OPCODE : {
+    TARGET(POP_FRAME_OPCODE) {
       DECODE_A_UNSIGNED();
       int num_locals = value;
       POP_FRAME(num_locals);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LIVE_OPCODE : {
+    TARGET(POP_FRAME_GET_REG_OPCODE) {
+      DECODE_B_UNSIGNED();
+      int num_locals = value;
+      POP_FRAME(num_locals);
+      SET_LOCAL(x, registers[0]);
+      NEXT_INSTRUCTION();
+    }
+    TARGET(LIVE_OPCODE) {
       DECODE_A_UNSIGNED();
       stack_pointer->liveness_map = value;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ENTER_STACK_OPCODE : {
+    TARGET(ENTER_STACK_OPCODE) {
       DECODE_A_UNSIGNED();
       //Save current stack
       stk->stack_pointer = stack_pointer;
@@ -1062,9 +1533,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       uint64_t fid = stk->pc;
       uint64_t stk_pc = code_offsets[fid];
       pc = instructions + stk_pc;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case YIELD_OPCODE : {
+    TARGET(YIELD_OPCODE) {
       DECODE_A_UNSIGNED();
       //Save current stack
       stk->stack_pointer = stack_pointer;
@@ -1075,10 +1546,16 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       stack_pointer = stk->stack_pointer;
       stack_limit = (char*)(stk->frames) + stk->size;
       pc = instructions + stk->pc;
-      continue;
+      NEXT_INSTRUCTION();
+    }
+    TARGET(RETURN_OPCODE_LOCAL) {
+      DECODE_A_UNSIGNED();
+      SET_REG(0, LOCAL(value));
+      goto return_from_function;
     }
-    case RETURN_OPCODE : {
+    TARGET(RETURN_OPCODE) {
       DECODE_A_UNSIGNED();
+      return_from_function: ;
       int64_t retpc = stack_pointer->returnpc;
       if(retpc == SYSTEM_RETURN_STUB){
         //System stack no longer needed
@@ -1098,7 +1575,7 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
         retpc = stk->pc;
 
         pc = instructions + retpc;
-        continue;
+        NEXT_INSTRUCTION();
       }
       else if(retpc < 0){
         //Save registers
@@ -1109,10 +1586,10 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       }
       else{
         pc = instructions + retpc;
-        continue;
+        NEXT_INSTRUCTION();
       }
     }
-    case DUMP_OPCODE : {
+    TARGET(DUMP_OPCODE) {
       DECODE_A_UNSIGNED();
       int64_t xl = (int64_t)LOCAL(value);
       char xb = (char)xl;
@@ -1121,574 +1598,574 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       float xd = LOCAL_DOUBLE(value);
       printf("DUMP LOCAL %d: (byte = %d, int = %d, long = %" PRId64 ", ptr = %p, float = %f, double = %f)\n",
              value, xb, xi, xl, (void*)xl, xf, xd);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_ADD_OPCODE : {
+    TARGET(INT_ADD_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) + (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_SUB_OPCODE : {
+    TARGET(INT_SUB_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) - (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_MUL_OPCODE : {
+    TARGET(INT_MUL_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, ((int64_t)(LOCAL(y)) >> 32LL) * (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_DIV_OPCODE : {
+    TARGET(INT_DIV_OPCODE) {
       DECODE_C();
       int64_t sy = (int64_t)LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       SET_LOCAL(x, (sy / sz) << 32LL);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_MOD_OPCODE : {
+    TARGET(INT_MOD_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) % (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_AND_OPCODE : {
+    TARGET(INT_AND_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) & (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_OR_OPCODE : {
+    TARGET(INT_OR_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) | (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_XOR_OPCODE : {
+    TARGET(INT_XOR_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) ^ (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_SHL_OPCODE : {
+    TARGET(INT_SHL_OPCODE) {
       DECODE_C();
       int64_t sy = (int64_t)LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       SET_LOCAL(x, sy << (sz >> 32LL));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_SHR_OPCODE : {
+    TARGET(INT_SHR_OPCODE) {
       DECODE_C();
       uint64_t uy = LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       uint64_t r = uy >> (sz >> 32LL);
       SET_LOCAL(x, (r >> 32LL) << 32LL);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_ASHR_OPCODE : {
+    TARGET(INT_ASHR_OPCODE) {
       DECODE_C();
       int64_t sy = (int64_t)LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       uint64_t r = sy >> (sz >> 32LL);
       SET_LOCAL(x, (r >> 32LL) << 32LL);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_LT_OPCODE : {
+    TARGET(INT_LT_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) < (int64_t)(LOCAL(value))));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_GT_OPCODE : {
+    TARGET(INT_GT_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) > (int64_t)(LOCAL(value))));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_LE_OPCODE : {
+    TARGET(INT_LE_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) <= (int64_t)(LOCAL(value))));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_GE_OPCODE : {
+    TARGET(INT_GE_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) >= (int64_t)(LOCAL(value))));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case REF_EQ_OPCODE : {
+    TARGET(REF_EQ_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF(LOCAL(y) == LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case EQ_OPCODE_REF : {
+    TARGET(EQ_OPCODE_REF) {
       DECODE_C();
       SET_LOCAL(x, LOCAL(y) == LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case EQ_OPCODE_BYTE : {
+    TARGET(EQ_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)LOCAL(y) == (uint8_t)LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case EQ_OPCODE_INT : {
+    TARGET(EQ_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)LOCAL(y) == (int32_t)LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case EQ_OPCODE_LONG : {
+    TARGET(EQ_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)LOCAL(y) == (int64_t)LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case EQ_OPCODE_FLOAT : {
+    TARGET(EQ_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) == LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case EQ_OPCODE_DOUBLE : {
+    TARGET(EQ_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) == LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case REF_NE_OPCODE : {
+    TARGET(REF_NE_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF(LOCAL(y) != LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NE_OPCODE_REF : {
+    TARGET(NE_OPCODE_REF) {
       DECODE_C();
       SET_LOCAL(x, LOCAL(y) != LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NE_OPCODE_BYTE : {
+    TARGET(NE_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)LOCAL(y) != (uint8_t)LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NE_OPCODE_INT : {
+    TARGET(NE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)LOCAL(y) != (int32_t)LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NE_OPCODE_LONG : {
+    TARGET(NE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)LOCAL(y) != (int64_t)LOCAL(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NE_OPCODE_FLOAT : {
+    TARGET(NE_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) != LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NE_OPCODE_DOUBLE : {
+    TARGET(NE_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) != LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ADD_OPCODE_BYTE : {
+    TARGET(ADD_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) + (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ADD_OPCODE_INT : {
+    TARGET(ADD_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) + (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ADD_OPCODE_LONG : {
+    TARGET(ADD_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) + (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ADD_OPCODE_FLOAT : {
+    TARGET(ADD_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) + LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ADD_OPCODE_DOUBLE : {
+    TARGET(ADD_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) + LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SUB_OPCODE_BYTE : {
+    TARGET(SUB_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) - (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SUB_OPCODE_INT : {
+    TARGET(SUB_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) - (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SUB_OPCODE_LONG : {
+    TARGET(SUB_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) - (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SUB_OPCODE_FLOAT : {
+    TARGET(SUB_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) - LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SUB_OPCODE_DOUBLE : {
+    TARGET(SUB_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) - LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MUL_OPCODE_BYTE : {
+    TARGET(MUL_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) * (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MUL_OPCODE_INT : {
+    TARGET(MUL_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) * (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MUL_OPCODE_LONG : {
+    TARGET(MUL_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) * (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MUL_OPCODE_FLOAT : {
+    TARGET(MUL_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) * LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MUL_OPCODE_DOUBLE : {
+    TARGET(MUL_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) * LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DIV_OPCODE_BYTE : {
+    TARGET(DIV_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) / (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DIV_OPCODE_INT : {
+    TARGET(DIV_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) / (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DIV_OPCODE_LONG : {
+    TARGET(DIV_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) / (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DIV_OPCODE_FLOAT : {
+    TARGET(DIV_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) / LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DIV_OPCODE_DOUBLE : {
+    TARGET(DIV_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) / LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MOD_OPCODE_BYTE : {
+    TARGET(MOD_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) % (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MOD_OPCODE_INT : {
+    TARGET(MOD_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) % (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case MOD_OPCODE_LONG : {
+    TARGET(MOD_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) % (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case AND_OPCODE_BYTE : {
+    TARGET(AND_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) & (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case AND_OPCODE_INT : {
+    TARGET(AND_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) & (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case AND_OPCODE_LONG : {
+    TARGET(AND_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) & (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case OR_OPCODE_BYTE : {
+    TARGET(OR_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) | (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case OR_OPCODE_INT : {
+    TARGET(OR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) | (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case OR_OPCODE_LONG : {
+    TARGET(OR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) | (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case XOR_OPCODE_BYTE : {
+    TARGET(XOR_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) ^ (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case XOR_OPCODE_INT : {
+    TARGET(XOR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) ^ (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case XOR_OPCODE_LONG : {
+    TARGET(XOR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) ^ (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SHL_OPCODE_BYTE : {
+    TARGET(SHL_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) << (char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SHL_OPCODE_INT : {
+    TARGET(SHL_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) << (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SHL_OPCODE_LONG : {
+    TARGET(SHL_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) << (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SHR_OPCODE_BYTE : {
+    TARGET(SHR_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (unsigned char)(LOCAL(y)) >> (unsigned char)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SHR_OPCODE_INT : {
+    TARGET(SHR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) >> (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SHR_OPCODE_LONG : {
+    TARGET(SHR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) >> (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ASHR_OPCODE_INT : {
+    TARGET(ASHR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) >> (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ASHR_OPCODE_LONG : {
+    TARGET(ASHR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) >> (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LT_OPCODE_INT : {
+    TARGET(LT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) < (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LT_OPCODE_LONG : {
+    TARGET(LT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) < (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LT_OPCODE_FLOAT : {
+    TARGET(LT_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) < LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LT_OPCODE_DOUBLE : {
+    TARGET(LT_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) < LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GT_OPCODE_INT : {
+    TARGET(GT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) > (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GT_OPCODE_LONG : {
+    TARGET(GT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) > (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GT_OPCODE_FLOAT : {
+    TARGET(GT_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) > LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GT_OPCODE_DOUBLE : {
+    TARGET(GT_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) > LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LE_OPCODE_INT : {
+    TARGET(LE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) <= (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LE_OPCODE_LONG : {
+    TARGET(LE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) <= (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LE_OPCODE_FLOAT : {
+    TARGET(LE_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) <= LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LE_OPCODE_DOUBLE : {
+    TARGET(LE_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) <= LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GE_OPCODE_INT : {
+    TARGET(GE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) >= (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GE_OPCODE_LONG : {
+    TARGET(GE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) >= (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GE_OPCODE_FLOAT : {
+    TARGET(GE_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) >= LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GE_OPCODE_DOUBLE : {
+    TARGET(GE_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) >= LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
 
-    case ULE_OPCODE_BYTE : {
+    TARGET(ULE_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) <= (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ULE_OPCODE_INT : {
+    TARGET(ULE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) <= (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ULE_OPCODE_LONG : {
+    TARGET(ULE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) <= (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ULT_OPCODE_BYTE : {
+    TARGET(ULT_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) < (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ULT_OPCODE_INT : {
+    TARGET(ULT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) < (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ULT_OPCODE_LONG : {
+    TARGET(ULT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) < (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case UGT_OPCODE_BYTE : {
+    TARGET(UGT_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) > (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case UGT_OPCODE_INT : {
+    TARGET(UGT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) > (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case UGT_OPCODE_LONG : {
+    TARGET(UGT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) > (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case UGE_OPCODE_BYTE : {
+    TARGET(UGE_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) >= (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case UGE_OPCODE_INT : {
+    TARGET(UGE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) >= (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case UGE_OPCODE_LONG : {
+    TARGET(UGE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) >= (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_NOT_OPCODE : {
+    TARGET(INT_NOT_OPCODE) {
       DECODE_B_UNSIGNED();
       uint64_t y = LOCAL(value);
       SET_LOCAL(x, ((~ y) >> 32LL) << 32LL);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case INT_NEG_OPCODE : {
+    TARGET(INT_NEG_OPCODE) {
       DECODE_B_UNSIGNED();
       int64_t y = LOCAL(value);
       SET_LOCAL(x, - y);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NOT_OPCODE_BYTE : {
+    TARGET(NOT_OPCODE_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ~ ((uint8_t)LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NOT_OPCODE_INT : {
+    TARGET(NOT_OPCODE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ~ ((uint32_t)LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NOT_OPCODE_LONG : {
+    TARGET(NOT_OPCODE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ~ ((uint64_t)LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NEG_OPCODE_INT : {
+    TARGET(NEG_OPCODE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, - ((int32_t)LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NEG_OPCODE_LONG : {
+    TARGET(NEG_OPCODE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, - ((int64_t)LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NEG_OPCODE_FLOAT : {
+    TARGET(NEG_OPCODE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, - LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case NEG_OPCODE_DOUBLE : {
+    TARGET(NEG_OPCODE_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, - LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DEREF_OPCODE : {
+    TARGET(DEREF_OPCODE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, LOCAL(value) + 8 - REF_TAG_BITS);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TYPEOF_OPCODE : {
+    TARGET(TYPEOF_OPCODE) {
       DECODE_C();
       int format = value;
       int index = read_dispatch_table(vms, format);
       SET_LOCAL(x, index);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case JUMP_SET_OPCODE : {
+    TARGET(JUMP_SET_OPCODE) {
       DECODE_F();
       F_JUMP(LOCAL(x));
     }
-    case JUMP_TAGBITS_OPCODE : {
+    TARGET(JUMP_TAGBITS_OPCODE) {
       DECODE_F();
       int tagbits = (int)(LOCAL(x)) & 0x7;
       int bits = y;
       F_JUMP(tagbits == bits);
     }
-    case JUMP_TAGWORD_OPCODE : {
+    TARGET(JUMP_TAGWORD_OPCODE) {
       DECODE_F();
       uint64_t obj = LOCAL(x);
       int tagbits = (int)obj & 0x7;
@@ -1698,229 +2175,230 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
         F_JUMP(*p == tag);
       }else{
         pc = pc0 + (n2 * 4);
-        continue;
+        NEXT_INSTRUCTION();
       }
     }
-    case GOTO_OPCODE : {
+    TARGET(GOTO_OPCODE) {
       DECODE_A_SIGNED();
       pc = pc0 + (value * 4);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_BYTE_FLOAT : {
+    TARGET(CONV_OPCODE_BYTE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (uint8_t)(LOCAL_FLOAT(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_BYTE_DOUBLE : {
+    TARGET(CONV_OPCODE_BYTE_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (uint8_t)(LOCAL_DOUBLE(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_INT_BYTE : {
+    TARGET(CONV_OPCODE_INT_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int32_t)(uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_INT_FLOAT : {
+    TARGET(CONV_OPCODE_INT_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int32_t)(LOCAL_FLOAT(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_INT_DOUBLE : {
+    TARGET(CONV_OPCODE_INT_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int32_t)(LOCAL_DOUBLE(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_LONG_BYTE : {
+    TARGET(CONV_OPCODE_LONG_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_LONG_INT : {
+    TARGET(CONV_OPCODE_LONG_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_LONG_FLOAT : {
+    TARGET(CONV_OPCODE_LONG_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(LOCAL_FLOAT(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_LONG_DOUBLE : {
+    TARGET(CONV_OPCODE_LONG_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(LOCAL_DOUBLE(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_FLOAT_BYTE : {
+    TARGET(CONV_OPCODE_FLOAT_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_FLOAT_INT : {
+    TARGET(CONV_OPCODE_FLOAT_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_FLOAT_LONG : {
+    TARGET(CONV_OPCODE_FLOAT_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_FLOAT_DOUBLE : {
+    TARGET(CONV_OPCODE_FLOAT_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, LOCAL_DOUBLE(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_DOUBLE_BYTE : {
+    TARGET(CONV_OPCODE_DOUBLE_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_DOUBLE_INT : {
+    TARGET(CONV_OPCODE_DOUBLE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, (int32_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_DOUBLE_LONG : {
+    TARGET(CONV_OPCODE_DOUBLE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, (int64_t)(LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CONV_OPCODE_DOUBLE_FLOAT : {
+    TARGET(CONV_OPCODE_DOUBLE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, LOCAL_FLOAT(value));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DETAG_OPCODE : {
+    TARGET(DETAG_OPCODE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, LOCAL(value) >> 32LL);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TAG_OPCODE_BYTE : {
+    TARGET(TAG_OPCODE_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)(uint8_t)(LOCAL(value)) << 32LL) + BYTE_TAG_BITS);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TAG_OPCODE_CHAR : {
+    TARGET(TAG_OPCODE_CHAR) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)(uint8_t)(LOCAL(value)) << 32LL) + CHAR_TAG_BITS);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TAG_OPCODE_INT : {
+    TARGET(TAG_OPCODE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)LOCAL(value) << 32LL) + INT_TAG_BITS);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TAG_OPCODE_FLOAT : {
+    TARGET(TAG_OPCODE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)LOCAL(value) << 32LL) + FLOAT_TAG_BITS);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_OPCODE_1 : {
+    TARGET(STORE_OPCODE_1) {
       DECODE_E();
       char* address = (char*)(LOCAL(x) + value);
       char storeval = (char)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_OPCODE_4 : {
+    TARGET(STORE_OPCODE_4) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(x) + value);
       int32_t storeval = (int32_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_OPCODE_8 : {
+    TARGET(STORE_OPCODE_8) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(x) + value);
       int64_t storeval = (int64_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_OPCODE_1_VAR_OFFSET : {
+    TARGET(STORE_OPCODE_1_VAR_OFFSET) {
       DECODE_E();
       char* address = (char*)(LOCAL(x) + LOCAL(y) + value);
       char storeval = (char)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_OPCODE_4_VAR_OFFSET : {
+    TARGET(STORE_OPCODE_4_VAR_OFFSET) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(x) + LOCAL(y) + value);
       int32_t storeval = (int32_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_OPCODE_8_VAR_OFFSET : {
+    TARGET(STORE_OPCODE_8_VAR_OFFSET) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(x) + LOCAL(y) + value);
       int64_t storeval = (int64_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_WITH_BARRIER_OPCODE : {
+    TARGET(STORE_WITH_BARRIER_OPCODE) {
       DECODE_E();
 
       //Retrieve address to store to and value to store.
       uint64_t* address = (uint64_t*)(LOCAL(x) + value);
       uint64_t val = (uint64_t)(LOCAL(z));
       barriered_store(vms, address, val);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case STORE_WITH_BARRIER_OPCODE_VAR_OFFSET : {
+    TARGET(STORE_WITH_BARRIER_OPCODE_VAR_OFFSET) {
       DECODE_E();
 
       //Retrieve address to store to and value to store.
       uint64_t* address = (uint64_t*)(LOCAL(x) + LOCAL(y) + value);
       uint64_t val = (uint64_t)(LOCAL(z));
       barriered_store(vms, address, val);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LOAD_OPCODE_1 : {
+    TARGET(LOAD_OPCODE_1) {
       DECODE_E();
       char* address = (char*)(LOCAL(y) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LOAD_OPCODE_4 : {
+    TARGET(LOAD_OPCODE_4) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(y) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LOAD_OPCODE_8 : {
+    TARGET(LOAD_OPCODE_8) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(y) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LOAD_OPCODE_1_VAR_OFFSET : {
+    TARGET(LOAD_OPCODE_1_VAR_OFFSET) {
       DECODE_E();
       char* address = (char*)(LOCAL(y) + LOCAL(z) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LOAD_OPCODE_4_VAR_OFFSET : {
+    TARGET(LOAD_OPCODE_4_VAR_OFFSET) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(y) + LOCAL(z) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LOAD_OPCODE_8_VAR_OFFSET : {
+    TARGET(LOAD_OPCODE_8_VAR_OFFSET) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(y) + LOCAL(z) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case RESERVE_OPCODE_LOCAL : {
+    TARGET(RESERVE_OPCODE_LOCAL) {
       DECODE_C();
       uint64_t size = 8 + LOCAL(value);
       size = (size + 7) & -8;
       int num_locals = y;
       int offset = x * 4;
-      if(heap_top + size <= heap_limit){
+      //Large objects are allocated by extend-heap in the large-object space.
+      if(size < LARGE_OBJECT_THRESHOLD && heap_top + size <= heap_limit){
         pc = pc0 + offset;
-        continue;
+        NEXT_INSTRUCTION();
       }else{
         SET_REG(0, BOOLREF(0));
         SET_REG(1, 1ULL);
@@ -1928,17 +2406,17 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
         uint64_t fpos = code_offsets[EXTEND_HEAP_FN];
         PUSH_FRAME(num_locals);
         pc = instructions + fpos;
-        continue;
+        NEXT_INSTRUCTION();
       }
     }
-    case RESERVE_OPCODE_CONST : {
+    TARGET(RESERVE_OPCODE_CONST) {
       DECODE_C();
       uint64_t size = value;
       int num_locals = y;
       int offset = x * 4;
       if(heap_top + size <= heap_limit){
         pc = pc0 + offset;
-        continue;
+        NEXT_INSTRUCTION();
       }else{
         SET_REG(0, BOOLREF(0));
         SET_REG(1, 1ULL);
@@ -1946,10 +2424,10 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
         uint64_t fpos = code_offsets[EXTEND_HEAP_FN];
         PUSH_FRAME(num_locals);
         pc = instructions + fpos;
-        continue;
+        NEXT_INSTRUCTION();
       }
     }
-    case ALLOC_OPCODE_CONST : {
+    TARGET(ALLOC_OPCODE_CONST) {
       DECODE_C();
       int num_bytes = 8 + y;
       int type = value;
@@ -1957,9 +2435,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       uint64_t obj = ptr_to_ref(heap_top);
       SET_LOCAL(x, obj);
       heap_top = heap_top + num_bytes;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case ALLOC_OPCODE_LOCAL : {
+    TARGET(ALLOC_OPCODE_LOCAL) {
       DECODE_C();
       uint64_t num_bytes = 8 + LOCAL(y);
       num_bytes = (num_bytes + 7) & -8;
@@ -1968,9 +2446,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       uint64_t obj = ptr_to_ref(heap_top);
       SET_LOCAL(x, obj);
       heap_top = heap_top + num_bytes;
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case GC_OPCODE : {
+    TARGET(GC_OPCODE) {
       DECODE_B_UNSIGNED();
       //Size to extend
       uint64_t size = LOCAL(value);
@@ -1980,237 +2458,239 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       RESTORE_STATE();
       //Return heap remaining
       SET_LOCAL(x, remaining);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case PRINT_STACK_TRACE_OPCODE : {
+    TARGET(PRINT_STACK_TRACE_OPCODE) {
       DECODE_B_UNSIGNED();
       uint64_t stack = LOCAL(value);
       call_print_stack_trace(vms, stack);
       SET_LOCAL(x, 0);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case COLLECT_STACK_TRACE_OPCODE : {
+    TARGET(COLLECT_STACK_TRACE_OPCODE) {
       DECODE_B_UNSIGNED();
       uint64_t stack = LOCAL(value);
       void* packed_trace = call_collect_stack_trace(vms, stack);
       SET_LOCAL(x, (uint64_t)packed_trace);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case FLUSH_VM_OPCODE : {
+    TARGET(FLUSH_VM_OPCODE) {
       DECODE_A_UNSIGNED();
       SAVE_STATE();
       SET_LOCAL(value, (uint64_t)vms);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case C_RSP_OPCODE : {
+    TARGET(C_RSP_OPCODE) {
       DECODE_A_UNSIGNED();
       SET_LOCAL(value, stanza_crsp);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case JUMP_INT_LT_OPCODE : {
+    TARGET(JUMP_INT_LT_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) < (int64_t)LOCAL(y));
     }
-    case JUMP_INT_GT_OPCODE : {
+    TARGET(JUMP_INT_GT_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) > (int64_t)LOCAL(y));
     }
-    case JUMP_INT_LE_OPCODE : {
+    TARGET(JUMP_INT_LE_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) <= (int64_t)LOCAL(y));
     }
-    case JUMP_INT_GE_OPCODE : {
+    TARGET(JUMP_INT_GE_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) >= (int64_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_REF : {
+    TARGET(JUMP_EQ_OPCODE_REF) {
       DECODE_F();
       F_JUMP(LOCAL(x) == LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_BYTE : {
+    TARGET(JUMP_EQ_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((int8_t)LOCAL(x) == (int8_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_INT : {
+    TARGET(JUMP_EQ_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) == (int32_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_LONG : {
+    TARGET(JUMP_EQ_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) == (int64_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_FLOAT : {
+    TARGET(JUMP_EQ_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) == LOCAL_FLOAT(y));
     }
-    case JUMP_EQ_OPCODE_DOUBLE : {
+    TARGET(JUMP_EQ_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) == LOCAL_DOUBLE(y));
     }
-    case JUMP_NE_OPCODE_REF : {
+    TARGET(JUMP_NE_OPCODE_REF) {
       DECODE_F();
       F_JUMP(LOCAL(x) != LOCAL(y));
     }
-    case JUMP_NE_OPCODE_BYTE : {
+    TARGET(JUMP_NE_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((int8_t)LOCAL(x) != (int8_t)LOCAL(y));
     }
-    case JUMP_NE_OPCODE_INT : {
+    TARGET(JUMP_NE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) != (int32_t)LOCAL(y));
     }
-    case JUMP_NE_OPCODE_LONG : {
+    TARGET(JUMP_NE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) != (int64_t)LOCAL(y));
     }
-    case JUMP_NE_OPCODE_FLOAT : {
+    TARGET(JUMP_NE_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) != LOCAL_FLOAT(y));
     }
-    case JUMP_NE_OPCODE_DOUBLE : {
+    TARGET(JUMP_NE_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) != LOCAL_DOUBLE(y));
     }
-    case JUMP_LT_OPCODE_INT : {
+    TARGET(JUMP_LT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) < (int32_t)LOCAL(y));
     }
-    case JUMP_LT_OPCODE_LONG : {
+    TARGET(JUMP_LT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) < (int64_t)LOCAL(y));
     }
-    case JUMP_LT_OPCODE_FLOAT : {
+    TARGET(JUMP_LT_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) < LOCAL_FLOAT(y));
     }
-    case JUMP_LT_OPCODE_DOUBLE : {
+    TARGET(JUMP_LT_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) < LOCAL_DOUBLE(y));
     }
-    case JUMP_GT_OPCODE_INT : {
+    TARGET(JUMP_GT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) > (int32_t)LOCAL(y));
     }
-    case JUMP_GT_OPCODE_LONG : {
+    TARGET(JUMP_GT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) > (int64_t)LOCAL(y));
     }
-    case JUMP_GT_OPCODE_FLOAT : {
+    TARGET(JUMP_GT_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) > LOCAL_FLOAT(y));
     }
-    case JUMP_GT_OPCODE_DOUBLE : {
+    TARGET(JUMP_GT_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) > LOCAL_DOUBLE(y));
     }
-    case JUMP_LE_OPCODE_INT : {
+    TARGET(JUMP_LE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) <= (int32_t)LOCAL(y));
     }
-    case JUMP_LE_OPCODE_LONG : {
+    TARGET(JUMP_LE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) <= (int64_t)LOCAL(y));
     }
-    case JUMP_LE_OPCODE_FLOAT : {
+    TARGET(JUMP_LE_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) <= LOCAL_FLOAT(y));
     }
-    case JUMP_LE_OPCODE_DOUBLE : {
+    TARGET(JUMP_LE_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) <= LOCAL_DOUBLE(y));
     }
-    case JUMP_GE_OPCODE_INT : {
+    TARGET(JUMP_GE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) >= (int32_t)LOCAL(y));
     }
-    case JUMP_GE_OPCODE_LONG : {
+    TARGET(JUMP_GE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) >= (int64_t)LOCAL(y));
     }
-    case JUMP_GE_OPCODE_FLOAT : {
+    TARGET(JUMP_GE_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) >= LOCAL_FLOAT(y));
     }
-    case JUMP_GE_OPCODE_DOUBLE : {
+    TARGET(JUMP_GE_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) >= LOCAL_DOUBLE(y));
     }
-    case JUMP_ULE_OPCODE_BYTE : {
+    TARGET(JUMP_ULE_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) <= (uint8_t)LOCAL(y));
     }
-    case JUMP_ULE_OPCODE_INT : {
+    TARGET(JUMP_ULE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) <= (uint32_t)LOCAL(y));
     }
-    case JUMP_ULE_OPCODE_LONG : {
+    TARGET(JUMP_ULE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) <= (uint64_t)LOCAL(y));
     }
-    case JUMP_ULT_OPCODE_BYTE : {
+    TARGET(JUMP_ULT_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) < (uint8_t)LOCAL(y));
     }
-    case JUMP_ULT_OPCODE_INT : {
+    TARGET(JUMP_ULT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) < (uint32_t)LOCAL(y));
     }
-    case JUMP_ULT_OPCODE_LONG : {
+    TARGET(JUMP_ULT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) < (uint64_t)LOCAL(y));
     }
-    case JUMP_UGE_OPCODE_BYTE : {
+    TARGET(JUMP_UGE_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) >= (uint8_t)LOCAL(y));
     }
-    case JUMP_UGE_OPCODE_INT : {
+    TARGET(JUMP_UGE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) >= (uint32_t)LOCAL(y));
     }
-    case JUMP_UGE_OPCODE_LONG : {
+    TARGET(JUMP_UGE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) >= (uint64_t)LOCAL(y));
     }
-    case JUMP_UGT_OPCODE_BYTE : {
+    TARGET(JUMP_UGT_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) > (uint8_t)LOCAL(y));
     }
-    case JUMP_UGT_OPCODE_INT : {
+    TARGET(JUMP_UGT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) > (uint32_t)LOCAL(y));
     }
-    case JUMP_UGT_OPCODE_LONG : {
+    TARGET(JUMP_UGT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) > (uint64_t)LOCAL(y));
     }
-    case DISPATCH_OPCODE : {
+    TARGET(DISPATCH_OPCODE) {
       DECODE_A_UNSIGNED();
-      uint32_t* tgts = (uint32_t*)(pc + 4);
+      DispatchCache* cache = (DispatchCache*)pc;
+      uint32_t* tgts = (uint32_t*)(pc + sizeof(DispatchCache) + 4);
       //DECODE_TGTS();
       int format = value;
-      int index = read_dispatch_table(vms, format);
+      int index = read_cached_dispatch_table(cache, vms, format);
       int tgt = tgts[index];
       pc = pc0 + (tgt * 4);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case DISPATCH_METHOD_OPCODE : {
+    TARGET(DISPATCH_METHOD_OPCODE) {
       DECODE_A_UNSIGNED();
-      uint32_t* tgts = (uint32_t*)(pc + 4);
+      DispatchCache* cache = (DispatchCache*)pc;
+      uint32_t* tgts = (uint32_t*)(pc + sizeof(DispatchCache) + 4);
       //DECODE_TGTS();
       int format = value;
-      int index = read_dispatch_table(vms, format);
+      int index = read_cached_dispatch_table(cache, vms, format);
       if(index < 2){
         int tgt = tgts[index];
         pc = pc0 + (tgt * 4);
-        continue;
+        NEXT_INSTRUCTION();
       }else{
         int fid = index - 2;
         uint64_t fpos = code_offsets[fid];
         pc = instructions + fpos;
-        continue;
+        NEXT_INSTRUCTION();
       }
     }
-    case JUMP_REG_OPCODE : {
+    TARGET(JUMP_REG_OPCODE) {
       DECODE_C();
       int reg = x;
       uint64_t arity = y;
@@ -2218,9 +2698,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
       if(registers[reg] == arity){
         pc = pc0 + offset;
       }
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case FNENTRY_OPCODE : {
+    TARGET(FNENTRY_OPCODE) {
       DECODE_A_UNSIGNED();
       int frame_size = value * 8 + sizeof(StackFrame);
       int size_required = frame_size + sizeof(StackFrame);
@@ -2249,51 +2729,54 @@ void vmloop (VMState* vms, uint64_t stanza_crsp, int64_t starting_fid){
         uint64_t fpos = code_offsets[EXTEND_STACK_FN];
         pc = instructions + fpos;
       }
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case LOWEST_ZERO_BIT_COUNT_OPCODE_LONG : {
+    TARGET(LOWEST_ZERO_BIT_COUNT_OPCODE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, lowest_zero_bit_count((uint64_t)LOCAL(value)));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case SET_BIT_OPCODE : {
+    TARGET(SET_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       set_bit(bit_index, bitset_base);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case CLEAR_BIT_OPCODE : {
+    TARGET(CLEAR_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       clear_bit(bit_index, bitset_base);
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TEST_BIT_OPCODE : {
+    TARGET(TEST_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       SET_LOCAL(x, test_bit(bit_index, bitset_base));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TEST_AND_SET_BIT_OPCODE : {
+    TARGET(TEST_AND_SET_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       SET_LOCAL(x, test_and_set_bit(bit_index, bitset_base));
-      continue;
+      NEXT_INSTRUCTION();
     }
-    case TEST_AND_CLEAR_BIT_OPCODE : {
+    TARGET(TEST_AND_CLEAR_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       SET_LOCAL(x, test_and_clear_bit(bit_index, bitset_base));
-      continue;
+      NEXT_INSTRUCTION();
     }
     }
 
     //Done
+#ifdef CVM_THREADED_DISPATCH
+    invalid_opcode:
+#endif
     printf("Invalid opcode: %d\n", opcode);
     exit(-1);
   }
@@ -2368,35 +2851,37 @@ int lookup_etable (DKV* etable, int slot, int t, int n){
   return default_value(etable,n);
 }
 
-int dhash (int d, int x, int n){
-  uint32_t a = x;
-  a = (a + 0x7ed55d16 + d) + (a << 12);
-  a = (a ^ 0xc761c23c) ^ (a >> 19);
-  a = (a + 0x165667b1) + (a << 5);
-  a = (a + 0xd3a2646c) ^ (a << 9);
-  a = (a + 0xfd7046c5) + (a << 3);
-  a = (a ^ 0xb55a4f09) ^ (a >> 16);
-  return ((int)a & 0x7FFFFFFF) % n;
+//The hash tables have a power-of-two number of slots, so the hash
+//is reduced to a slot with a mask. Must match dhash in hash.stanza.
+int dhash (int d, int x, int mask){
+  uint32_t a = (uint32_t)x ^ ((uint32_t)d * 0x9e3779b9u);
+  a *= 0x85ebca6bu;
+  a ^= a >> 16;
+  return (int)(a & (uint32_t)mask);
 }
 
-int lookup_trie_table (VMState* vms, TrieTable* trie_table){
+int lookup_trie_table_type (TrieTable* trie_table, int type){
   int n = trie_table->n;
-  int type = argtype(vms, trie_table->index);
   if(n <= 4){
     return lookup_small_etable(small_etable(trie_table), type, n);
   }else{
     DTable* dtable = trie_dtable(trie_table);
-    int dslot = dhash(dtable->d0, type, n);
+    int mask = n - 1;
+    int dslot = dhash(dtable->d0, type, mask);
     int d = dtable->dtable[dslot];
     if(d == 0){
       return default_value(big_etable(dtable,n), n);
     }else{
-      int slot = d < 0? -d - 1 : dhash(d, type, n);
+      int slot = d < 0? -d - 1 : dhash(d, type, mask);
       return lookup_etable(big_etable(dtable,n), slot, type, n);
     }
   }
 }
 
+int lookup_trie_table (VMState* vms, TrieTable* trie_table){
+  return lookup_trie_table_type(trie_table, argtype(vms, trie_table->index));
+}
+
 int read_dispatch_table (VMState* vms, int format){
   int* trie_table = vms->trie_table[format];
   int table_offset = 0;
@@ -2406,3 +2891,80 @@ int read_dispatch_table (VMState* vms, int format){
     table_offset = value;
   }
 }
+
+//============================================================
+//================ Cached Dispatch Interpreter ===============
+//============================================================
+
+static int dispatch_cache_hit (DispatchCacheEntry* e, VMState* vms){
+  for(int i=0; i<e->num_args; i++)
+    if(argtype(vms, e->args[i]) != e->types[i]) return 0;
+  return 1;
+}
+
+//Read the dispatch table, and record the registers that were examined
+//in the entry. num_args is set to 0xFF if there were too many of them
+//to be cached, or if a register index does not fit in args.
+static int read_dispatch_table_into (VMState* vms, int format, DispatchCacheEntry* e){
+  int* trie_table = vms->trie_table[format];
+  int table_offset = 0;
+  e->num_args = 0;
+  while(1){
+    TrieTable* t = (TrieTable*)(trie_table + table_offset);
+    int type = argtype(vms, t->index);
+    if(e->num_args < MAX_CACHED_DISPATCH_ARGS && t->index <= UINT8_MAX){
+      e->args[e->num_args] = (uint8_t)t->index;
+      e->types[e->num_args] = type;
+      e->num_args++;
+    }else{
+      e->num_args = 0xFF;
+    }
+    int value = lookup_trie_table_type(t, type);
+    if(value < 0) return -value - 1;
+    table_offset = value;
+  }
+}
+
+//Read the dispatch table through the inline cache of a dispatch site.
+//On a miss, the result is stored in an empty entry if there is one,
+//and otherwise replaces the entries in turn.
+int read_cached_dispatch_table (DispatchCache* cache, VMState* vms, int format){
+  uint64_t epoch = vms->dispatch_epoch;
+  if(cache->uncached_epoch == epoch)
+    return read_dispatch_table(vms, format);
+  int empty = -1;
+  for(int i=0; i<DISPATCH_CACHE_SIZE; i++){
+    DispatchCacheEntry* e = &cache->entries[i];
+    if(e->epoch != epoch){
+      if(empty < 0) empty = i;
+    }
+    else if(dispatch_cache_hit(e, vms)){
+      return e->value;
+    }
+  }
+
+  DispatchCacheEntry entry;
+  int value = read_dispatch_table_into(vms, format, &entry);
+  if(entry.num_args != 0xFF){
+    int i = empty;
+    if(i < 0){
+      i = cache->next;
+      cache->next = (cache->next + 1) % DISPATCH_CACHE_SIZE;
+    }
+    entry.epoch = epoch;
+    entry.value = value;
+    cache->entries[i] = entry;
+  }else{
+    cache->uncached_epoch = epoch;
+  }
+  return value;
+}
+
+//Create the cache for a dispatch site of jitted code.
+DispatchCache* new_dispatch_cache (){
+  return (DispatchCache*)calloc(1, sizeof(DispatchCache));
+}
+
+void free_dispatch_cache (DispatchCache* cache){
+  free(cache);
+}
@@ -0,0 +1,204 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<errno.h>
+#include<stanza.h>
+#ifdef PLATFORM_LINUX
+  #include<sys/epoll.h>
+  #include<sys/syscall.h>
+#endif
+#ifndef PLATFORM_WINDOWS
+  #include<unistd.h>
+  #include<fcntl.h>
+  #include<poll.h>
+#endif
+
+//============================================================
+//============= Representation of Event Loop =================
+//============================================================
+//The event loop waits for file descriptors to become ready.
+//Each watch is one-shot: once the descriptor is reported as
+//ready, it must be watched again to be reported again.
+//The token of a watch is returned when its descriptor is ready.
+//
+//On Linux, the descriptors are watched with epoll. Elsewhere,
+//the watches are kept in an array that is passed to poll.
+
+//- epoll_fd: The epoll instance, on Linux.
+//- watches: The pending watches, on other platforms.
+//- tokens: The token of each pending watch, on other platforms.
+typedef struct {
+#ifdef PLATFORM_LINUX
+  int epoll_fd;
+#elif !defined(PLATFORM_WINDOWS)
+  struct pollfd* watches;
+  stz_long* tokens;
+  int num_watches;
+  int capacity;
+#endif
+} EventLoop;
+
+//============================================================
+//===================== Creation =============================
+//============================================================
+
+//Returns NULL if the event loop could not be created.
+EventLoop* event_loop_create (){
+#ifdef PLATFORM_WINDOWS
+  errno = ENOSYS;
+  return NULL;
+#else
+  EventLoop* loop = (EventLoop*)malloc(sizeof(EventLoop));
+#ifdef PLATFORM_LINUX
+  loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if(loop->epoll_fd < 0){
+    free(loop);
+    return NULL;
+  }
+#else
+  loop->capacity = 16;
+  loop->num_watches = 0;
+  loop->watches = (struct pollfd*)malloc(loop->capacity * sizeof(struct pollfd));
+  loop->tokens = (stz_long*)malloc(loop->capacity * sizeof(stz_long));
+#endif
+  return loop;
+#endif
+}
+
+//============================================================
+//===================== Watching =============================
+//============================================================
+
+//Watch the descriptor until it is readable, or writable if
+//writable is 1. Returns -1 if it cannot be watched.
+stz_int event_loop_watch (EventLoop* loop, stz_int fd, stz_int writable, stz_long token){
+#ifdef PLATFORM_WINDOWS
+  return -1;
+#elif defined(PLATFORM_LINUX)
+  struct epoll_event event;
+  event.events = (writable ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+  event.data.u64 = (uint64_t)token;
+  //A descriptor that has been watched before stays registered
+  //with epoll, and is re-armed instead.
+  if(epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0) return 0;
+  if(errno != ENOENT) return -1;
+  return (stz_int)epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+#else
+  if(loop->num_watches == loop->capacity){
+    loop->capacity *= 2;
+    loop->watches = (struct pollfd*)realloc(loop->watches, loop->capacity * sizeof(struct pollfd));
+    loop->tokens = (stz_long*)realloc(loop->tokens, loop->capacity * sizeof(stz_long));
+  }
+  struct pollfd* watch = &loop->watches[loop->num_watches];
+  watch->fd = fd;
+  watch->events = writable ? POLLOUT : POLLIN;
+  watch->revents = 0;
+  loop->tokens[loop->num_watches] = token;
+  loop->num_watches++;
+  return 0;
+#endif
+}
+
+//============================================================
+//===================== Waiting ==============================
+//============================================================
+
+//Wait until at least one watched descriptor is ready, or until
+//timeout_ms milliseconds have passed. A negative timeout waits
+//indefinitely. The tokens of the ready descriptors are stored in
+//tokens, up to max_tokens of them.
+//Returns the number of ready descriptors, or -1 on failure.
+stz_int event_loop_wait (EventLoop* loop, stz_long* tokens, stz_int max_tokens, stz_long timeout_ms){
+#ifdef PLATFORM_WINDOWS
+  return -1;
+#elif defined(PLATFORM_LINUX)
+  struct epoll_event events[max_tokens];
+  int n = epoll_wait(loop->epoll_fd, events, max_tokens, (int)timeout_ms);
+  if(n < 0) return errno == EINTR ? 0 : -1;
+  for(int i=0; i<n; i++)
+    tokens[i] = (stz_long)events[i].data.u64;
+  return n;
+#else
+  int n = poll(loop->watches, loop->num_watches, (int)timeout_ms);
+  if(n < 0) return errno == EINTR ? 0 : -1;
+  //Move the ready watches out, and keep the pending ones.
+  int num_ready = 0;
+  int num_pending = 0;
+  for(int i=0; i<loop->num_watches; i++){
+    if(loop->watches[i].revents != 0 && num_ready < max_tokens){
+      tokens[num_ready++] = loop->tokens[i];
+    }else{
+      loop->watches[num_pending] = loop->watches[i];
+      loop->tokens[num_pending] = loop->tokens[i];
+      num_pending++;
+    }
+  }
+  loop->num_watches = num_pending;
+  return num_ready;
+#endif
+}
+
+//============================================================
+//=================== Non-Blocking Reads =====================
+//============================================================
+
+//Read up to n bytes that are available from the descriptor.
+//Returns the number of bytes read, 0 at the end of the file,
+//-2 if no bytes are available yet, and -1 on failure.
+//The descriptor is only non-blocking for the duration of the read,
+//and its flags are restored afterwards.
+stz_long event_loop_read (stz_int fd, char* buffer, stz_long n){
+#ifdef PLATFORM_WINDOWS
+  return -1;
+#else
+  int flags = fcntl(fd, F_GETFL);
+  if(flags < 0) return -1;
+  int set_nonblock = !(flags & O_NONBLOCK);
+  if(set_nonblock && fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return -1;
+  ssize_t r = read(fd, buffer, (size_t)n);
+  int read_errno = errno;
+  if(set_nonblock && fcntl(fd, F_SETFL, flags) < 0) return -1;
+  if(r < 0){
+    errno = read_errno;
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? -2 : -1;
+  }
+  return (stz_long)r;
+#endif
+}
+
+//============================================================
+//===================== Processes ============================
+//============================================================
+
+//Returns a descriptor that becomes readable when the child process
+//exits, or -1 if the platform does not provide them.
+stz_int event_loop_pidfd (stz_long pid){
+#if defined(PLATFORM_LINUX) && defined(SYS_pidfd_open)
+  return (stz_int)syscall(SYS_pidfd_open, (pid_t)pid, 0);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+//Returns 0 if the descriptor was closed, and -1 otherwise.
+stz_int event_loop_close (stz_int fd){
+#ifdef PLATFORM_WINDOWS
+  return -1;
+#else
+  return (stz_int)close(fd);
+#endif
+}
+
+//============================================================
+//===================== Cleanup ==============================
+//============================================================
+
+void event_loop_delete (EventLoop* loop){
+#ifdef PLATFORM_LINUX
+  close(loop->epoll_fd);
+#elif !defined(PLATFORM_WINDOWS)
+  free(loop->watches);
+  free(loop->tokens);
+#endif
+  free(loop);
+}
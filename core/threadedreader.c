@@ -2,6 +2,9 @@
 #include<stdio.h>
 #include<stdlib.h>
 #include<stanza.h>
+#ifndef PLATFORM_WINDOWS
+  #include<unistd.h>
+#endif
 
 //============================================================
 //=================== Explanation of Stop ====================
@@ -23,6 +26,9 @@
 //- running: Holds 1 if the reader is running. Holds 0 if the
 //  reader has stopped, and its contents can be safely read.
 //- thread_running: Holds 1 if the thread is still executing.
+//- done_fds: A pipe that the thread writes to when it reaches the
+//  end of the stream, so that the end can be waited for by an event
+//  loop. Holds -1 on platforms without pipes.
 typedef struct {
   FILE* stream;
   pthread_t thread;
@@ -34,6 +40,7 @@ typedef struct {
   stz_int running;
   stz_int thread_running;
   stz_int free_on_finish;
+  int done_fds[2];
 } ThreadedReader;
 
 //============================================================
@@ -44,6 +51,12 @@ typedef struct {
 
 void free_threaded_reader_resources (ThreadedReader* reader){
   pthread_mutex_destroy(&reader->mutex);
+#ifndef PLATFORM_WINDOWS
+  if(reader->done_fds[0] >= 0){
+    close(reader->done_fds[0]);
+    close(reader->done_fds[1]);
+  }
+#endif
   free(reader->buffer);
   free(reader);  
 }
@@ -110,6 +123,14 @@ void* reader_thread (void* p){
   //reached the end of the stream.
   reader->running = 0;
 
+  //Notify anyone waiting for the end of the stream.
+#ifndef PLATFORM_WINDOWS
+  if(reader->done_fds[1] >= 0){
+    char done = 1;
+    if(write(reader->done_fds[1], &done, 1) < 0) {}
+  }
+#endif
+
   //Perform the following atomic operation:
   //  reader->thread_running = 0;
   //  int free_resources = reader->free_on_finish;
@@ -142,6 +163,14 @@ ThreadedReader* make_threaded_reader (FILE* stream) {
   reader->running = 1;
   reader->thread_running = 1;
   reader->free_on_finish = 0;
+  reader->done_fds[0] = -1;
+  reader->done_fds[1] = -1;
+#ifndef PLATFORM_WINDOWS
+  if(pipe(reader->done_fds) != 0){
+    reader->done_fds[0] = -1;
+    reader->done_fds[1] = -1;
+  }
+#endif
 
   //Start the thread, and return null if unsuccessful.
   int thread_ret = pthread_create(&reader->thread, NULL, reader_thread, reader);
@@ -159,6 +188,12 @@ ThreadedReader* make_threaded_reader (FILE* stream) {
 
   //Cleanup code
   failure_cleanup_reader:
+#ifndef PLATFORM_WINDOWS
+  if(reader->done_fds[0] >= 0){
+    close(reader->done_fds[0]);
+    close(reader->done_fds[1]);
+  }
+#endif
   free(reader->buffer);
   free(reader);
   return NULL;
@@ -200,6 +235,12 @@ stz_long threaded_reader_buffer_length (ThreadedReader* reader){
   return reader->length;
 }
 
+//Retrieve the descriptor that becomes readable when the reader
+//reaches the end of the stream, or -1 if there is none.
+stz_int threaded_reader_done_fd (ThreadedReader* reader){
+  return reader->done_fds[0];
+}
+
 //============================================================
 //================== Cleanup =================================
 //============================================================
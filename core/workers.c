@@ -0,0 +1,156 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<stanza.h>
+#ifdef PLATFORM_WINDOWS
+  #include<windows.h>
+#else
+  #include<unistd.h>
+  #include<sys/wait.h>
+#endif
+
+//============================================================
+//================ Representation of Worker ==================
+//============================================================
+
+//- pid: The process id of the worker in the parent, and 0 within
+//  the worker itself.
+//- stream: The pipe through which the worker writes its result.
+//  The read end in the parent, and the write end in the worker.
+//- result: The result read by finish_worker, malloc'd.
+//- status: The exit status of the worker, or -1 if it did not
+//  exit normally.
+typedef struct {
+  stz_long pid;
+  FILE* stream;
+  char* result;
+  stz_long result_length;
+  stz_int status;
+} Worker;
+
+//Defined in driver.c. Writes out the buffers of the FileOutputStreams
+//and of FILE.
+stz_int stz_flush_output_buffers (void);
+
+//============================================================
+//===================== Fork Worker ==========================
+//============================================================
+//Returns the new Worker in both processes, or NULL if the worker
+//could not be forked.
+
+Worker* fork_worker (){
+#ifdef PLATFORM_WINDOWS
+  errno = ENOSYS;
+  return NULL;
+#else
+  int fds[2];
+  if(pipe(fds) != 0) return NULL;
+
+  //Flush the buffered output, so that it is not written again
+  //by the worker.
+  stz_flush_output_buffers();
+
+  pid_t pid = fork();
+  if(pid < 0){
+    close(fds[0]);
+    close(fds[1]);
+    return NULL;
+  }
+
+  Worker* worker = (Worker*)malloc(sizeof(Worker));
+  worker->pid = pid;
+  worker->result = NULL;
+  worker->result_length = 0;
+  worker->status = 0;
+  if(pid == 0){
+    close(fds[0]);
+    worker->stream = fdopen(fds[1], "wb");
+  }else{
+    close(fds[1]);
+    worker->stream = fdopen(fds[0], "rb");
+  }
+  return worker;
+#endif
+}
+
+//============================================================
+//================== Within the Worker =======================
+//============================================================
+
+//Write the result of the worker to the parent.
+//Returns -1 if it could not all be written.
+stz_int write_worker_result (Worker* worker, char* result, stz_long length){
+  if(fwrite(result, 1, length, worker->stream) < (size_t)length) return -1;
+  return 0;
+}
+
+//Exit the worker without running the exit handlers of the parent.
+//The buffers are all empty at the fork, so flushing them here writes
+//out only what the worker itself wrote.
+void exit_worker (Worker* worker, stz_int code){
+  fclose(worker->stream);
+  stz_flush_output_buffers();
+#ifndef PLATFORM_WINDOWS
+  _exit(code);
+#endif
+}
+
+//============================================================
+//================== Within the Parent =======================
+//============================================================
+
+//Read the result of the worker until it exits, and then wait for it.
+//Returns -1 if the result could not be read or the worker could not be
+//waited for.
+stz_int finish_worker (Worker* worker){
+#ifdef PLATFORM_WINDOWS
+  return -1;
+#else
+  stz_long capacity = 1024;
+  worker->result = (char*)malloc(capacity);
+  while(1){
+    if(worker->result_length == capacity){
+      capacity *= 2;
+      worker->result = (char*)realloc(worker->result, capacity);
+    }
+    size_t n = fread(worker->result + worker->result_length, 1,
+                     capacity - worker->result_length, worker->stream);
+    worker->result_length += n;
+    if(n == 0) break;
+  }
+  int read_error = ferror(worker->stream);
+  fclose(worker->stream);
+  worker->stream = NULL;
+
+  int status;
+  while(waitpid((pid_t)worker->pid, &status, 0) < 0){
+    if(errno != EINTR) return -1;
+  }
+  if(WIFEXITED(status)) worker->status = WEXITSTATUS(status);
+  else worker->status = -1;
+  return read_error ? -1 : 0;
+#endif
+}
+
+void delete_worker (Worker* worker){
+  if(worker->stream != NULL) fclose(worker->stream);
+  free(worker->result);
+  free(worker);
+}
+
+//============================================================
+//==================== Processors ============================
+//============================================================
+
+//Return the number of processors that are online.
+stz_int num_processors (){
+#ifdef PLATFORM_WINDOWS
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (stz_int)info.dwNumberOfProcessors;
+#else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (stz_int)n : 1;
+#endif
+}
@@ -10,6 +10,9 @@
   #include<sys/wait.h>
   #include<sys/mman.h>
 #endif
+#ifdef PLATFORM_LINUX
+  #include<sys/syscall.h>
+#endif
 #include<stdint.h>
 #include<stdbool.h>
 #include<unistd.h>
@@ -20,6 +23,7 @@
 #include<fcntl.h>
 #include<signal.h>
 #include<string.h>
+#include<ctype.h>
 #include<sys/stat.h>
 #include<sys/types.h>
 #include<dirent.h>
@@ -35,6 +39,10 @@
 
 void* stz_malloc (stz_long size);
 void stz_free (void* ptr);
+void stz_memory_decommit (void* p, stz_long size);
+extern stz_long stz_huge_pages;
+extern stz_long stz_numa_policy;
+extern stz_long stz_numa_node;
 
 #ifdef PLATFORM_WINDOWS
 char* get_windows_api_error() {
@@ -107,6 +115,8 @@ typedef struct{
   stz_byte* marking_stack_start;
   stz_byte* marking_stack_bottom;
   stz_byte* marking_stack_top;
+  stz_byte* heap_dirty_cards;
+  stz_byte* heap_dirty_cards_base;
 } VMInit;
 
 //     Macro Readers
@@ -161,6 +171,139 @@ stz_long file_write_block (FILE* f, char* data, stz_long len) {
   return (stz_long)fwrite(data, 1, len, f);
 }
 
+//     Buffered File Output
+//     ====================
+//A FileOutputStream that owns its file collects its output in an OutputBuffer,
+//and only calls into C when the buffer is full or flushed. Its fields are written
+//directly by core.stanza. The open buffers are kept in a list, so that their
+//contents are written out at exit, like the buffers of FILE.
+typedef struct OutputBuffer {
+  stz_long length;
+  stz_long capacity;
+  FILE* file;
+  struct OutputBuffer* prev;
+  struct OutputBuffer* next;
+  stz_byte data[];
+} OutputBuffer;
+
+static OutputBuffer* open_output_buffers = NULL;
+
+//Write out the contents of the buffer, and empty it.
+//Returns -1 if they could not all be written.
+stz_int stz_flush_output_buffer (OutputBuffer* b) {
+  stz_long n = b->length;
+  b->length = 0;
+  if(n > 0 && fwrite(b->data, 1, (size_t)n, b->file) < (size_t)n) return -1;
+  return 0;
+}
+
+//Write out the contents of every open buffer, and then of every FILE.
+//Returns -1 if they could not all be written.
+stz_int stz_flush_output_buffers (void) {
+  stz_int result = 0;
+  for(OutputBuffer* b = open_output_buffers; b != NULL; b = b->next)
+    if(stz_flush_output_buffer(b) != 0) result = -1;
+  if(fflush(NULL) != 0) result = -1;
+  return result;
+}
+
+static void flush_output_buffers_at_exit (void) {
+  stz_flush_output_buffers();
+}
+
+//Create an empty buffer of the given capacity for the given file.
+OutputBuffer* stz_open_output_buffer (FILE* file, stz_long capacity) {
+  static bool registered_exit_handler = false;
+  OutputBuffer* b = (OutputBuffer*)stz_malloc(sizeof(OutputBuffer) + capacity);
+  if(b == NULL) exit_with_error();
+  b->length = 0;
+  b->capacity = capacity;
+  b->file = file;
+  b->prev = NULL;
+  b->next = open_output_buffers;
+  if(open_output_buffers != NULL) open_output_buffers->prev = b;
+  open_output_buffers = b;
+  if(!registered_exit_handler){
+    atexit(flush_output_buffers_at_exit);
+    registered_exit_handler = true;
+  }
+  return b;
+}
+
+//Write out the contents of the buffer, and free it.
+//Returns -1 if they could not all be written.
+stz_int stz_close_output_buffer (OutputBuffer* b) {
+  stz_int result = stz_flush_output_buffer(b);
+  if(b->prev != NULL) b->prev->next = b->next;
+  else open_output_buffers = b->next;
+  if(b->next != NULL) b->next->prev = b->prev;
+  stz_free(b);
+  return result;
+}
+
+//     Mapped Files
+//     ============
+//A MappedFile in core.stanza maps the whole of a file read-only, so that its
+//contents can be read without being copied into the heap.
+
+//Empty files cannot be mapped, and are represented by this address instead.
+static stz_byte empty_mapping[1];
+
+//Maps the file read-only, and stores its size in size.
+//Returns NULL if the file could not be opened or mapped.
+void* stz_map_file (const stz_byte* filename, stz_long* size) {
+#ifdef PLATFORM_WINDOWS
+  HANDLE file = CreateFileA(C_CSTR(filename), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return NULL;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    return NULL;
+  }
+  *size = (stz_long)file_size.QuadPart;
+  if (*size == 0) {
+    CloseHandle(file);
+    return empty_mapping;
+  }
+  //The view keeps the file and the mapping open until it is unmapped.
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) return NULL;
+  void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  return p;
+#else
+  int fd = open(C_CSTR(filename), O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return NULL;
+  }
+  *size = (stz_long)info.st_size;
+  if (*size == 0) {
+    close(fd);
+    return empty_mapping;
+  }
+  //The mapping keeps the file open until it is unmapped.
+  void* p = mmap(NULL, (size_t)*size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return NULL;
+  return p;
+#endif
+}
+
+//Unmaps a file mapped by stz_map_file. Returns -1 on failure.
+stz_int stz_unmap_file (void* p, stz_long size) {
+  if (p == empty_mapping) return 0;
+#ifdef PLATFORM_WINDOWS
+  return UnmapViewOfFile(p) ? 0 : -1;
+#else
+  return (stz_int)munmap(p, (size_t)size);
+#endif
+}
+
 
 //     Path Resolution
 //     ===============
@@ -491,18 +634,120 @@ static void protect(void* p, stz_long size, stz_int prot) {
   if (size && mprotect(p, (size_t)size, prot)) exit_with_error();
 }
 
+//Segments are aligned to this boundary when huge pages are enabled.
+#define HUGE_PAGE_SIZE (STZ_LONG(2) * 1024 * 1024)
+
+//Reserve size bytes starting at a multiple of HUGE_PAGE_SIZE.
+//An extra huge page is reserved, and the unaligned ends are unmapped.
+static void* map_huge_page_aligned (stz_long size) {
+  size_t reserved_size = (size_t)(size + HUGE_PAGE_SIZE);
+  char* p = mmap(NULL, reserved_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) exit_with_error();
+  char* aligned = (char*)(((uint64_t)p + (HUGE_PAGE_SIZE - 1)) & ~(uint64_t)(HUGE_PAGE_SIZE - 1));
+  size_t head = (size_t)(aligned - p);
+  size_t tail = reserved_size - head - (size_t)size;
+  if (head && munmap(p, head)) exit_with_error();
+  if (tail && munmap(aligned + size, tail)) exit_with_error();
+  return aligned;
+}
+
+#ifdef PLATFORM_LINUX
+
+//Memory policies of mbind, from <linux/mempolicy.h>.
+enum {
+  STZ_MPOL_BIND = 2,
+  STZ_MPOL_INTERLEAVE = 3
+};
+
+//Compute the mask of the online NUMA nodes.
+//Returns false if the nodes cannot be read.
+static bool online_numa_nodes (unsigned long* mask) {
+  FILE* f = fopen("/sys/devices/system/node/online", "r");
+  if (f == NULL) return false;
+  *mask = 0;
+  //The file holds a list of ranges, e.g. "0-3,6".
+  int start, end;
+  while (fscanf(f, "%d", &start) == 1) {
+    end = start;
+    int c = fgetc(f);
+    if (c == '-') {
+      if (fscanf(f, "%d", &end) != 1) break;
+      c = fgetc(f);
+    }
+    for (int n = start; n <= end && n < 64; n++)
+      *mask |= 1UL << n;
+    if (c != ',') break;
+  }
+  fclose(f);
+  return *mask != 0;
+}
+
+//Apply the NUMA policy of the runtime options to the given range.
+static bool bind_numa_memory (void* p, stz_long size) {
+  unsigned long mask;
+  int mode;
+  if (stz_numa_policy == 1) {
+    if (!online_numa_nodes(&mask)) return false;
+    mode = STZ_MPOL_INTERLEAVE;
+  } else {
+    mask = 1UL << stz_numa_node;
+    mode = STZ_MPOL_BIND;
+  }
+  return syscall(SYS_mbind, p, (unsigned long)size, mode, &mask, 64UL + 1, 0) == 0;
+}
+
+#endif
+
+//Apply the huge page and NUMA runtime options to the pages from p
+//(inclusive) to p + size (exclusive). The advice is lost when the pages are
+//remapped, and is reapplied by stz_memory_decommit.
+//Failures only lose performance, and are reported once.
+static void advise_memory (void* p, stz_long size) {
+#ifdef PLATFORM_LINUX
+  static bool warned = false;
+  bool advised = true;
+  if (stz_huge_pages && madvise(p, (size_t)size, MADV_HUGEPAGE))
+    advised = false;
+  if (stz_numa_policy && !bind_numa_memory(p, size))
+    advised = false;
+  if (!advised && !warned) {
+    fprintf(stderr, "Warning: Could not apply huge page or NUMA policy to the heap: %s.\n", strerror(errno));
+    warned = true;
+  }
+#endif
+}
+
 //Allocates a segment of memory that is min_size allocated, and can be
 //resized up to max_size.
 //This function is called from within Stanza, and min_size and max_size
 //are assumed to be multiples of the system page size.
+//All segments belong to the garbage collector, and follow the huge-pages and
+//numa runtime options.
 void* stz_memory_map (stz_long min_size, stz_long max_size) {
-  void* p = mmap(NULL, (size_t)max_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-  if (p == MAP_FAILED) exit_with_error();
+  void* p;
+  if (stz_huge_pages) {
+    p = map_huge_page_aligned(max_size);
+  } else {
+    p = mmap(NULL, (size_t)max_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) exit_with_error();
+  }
+  if (stz_huge_pages || stz_numa_policy) advise_memory(p, max_size);
 
   protect(p, min_size, PROT_READ | PROT_WRITE | PROT_EXEC);
   return p;
 }
 
+//Reserves a segment of memory for the frames of a stack. No pages are
+//committed. Unlike stz_memory_map, the segment does not belong to the
+//garbage collector, so the huge-pages and numa runtime options are not applied.
+//This function is called from within Stanza, and size is assumed to be a
+//multiple of the system page size.
+void* stz_stack_map (stz_long size) {
+  void* p = mmap(NULL, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) exit_with_error();
+  return p;
+}
+
 //Unmaps the region of memory.
 //This function is called from within Stanza, and size is
 //assumed to be a multiple of the system page size.
@@ -514,18 +759,46 @@ void stz_memory_unmap (void* p, stz_long size) {
 //old_size is assumed to be the size that is already allocated.
 //new_size is the size that we desired to be allocated, and
 //must be a multiple of the system page size.
+//The pages past new_size are released to the operating system when shrinking.
 void stz_memory_resize (void* p, stz_long old_size, stz_long new_size) {
-  stz_long min_size = old_size;
-  stz_long max_size = new_size;
-  int prot = PROT_READ | PROT_WRITE | PROT_EXEC;
+  //Case: if growing the allocated size.
+  if (new_size > old_size)
+    protect((char*)p + old_size, new_size - old_size, PROT_READ | PROT_WRITE | PROT_EXEC);
+  //Case: if shrinking the allocated size.
+  else if (new_size < old_size)
+    stz_memory_decommit((char*)p + new_size, old_size - new_size);
+}
 
-  if (min_size > max_size) {
-    min_size = new_size;
-    max_size = old_size;
-    prot = PROT_NONE;
-  }
+//Commits the pages from p (inclusive) to p + size (exclusive) of a
+//segment returned by stz_memory_map. The pages are zero when first committed.
+//p and size are assumed to be multiples of the system page size.
+void stz_memory_commit (void* p, stz_long size) {
+  protect(p, size, PROT_READ | PROT_WRITE | PROT_EXEC);
+}
 
-  protect((char*)p + min_size, max_size - min_size, prot);
+//Releases the pages from p (inclusive) to p + size (exclusive) to the
+//operating system, but keeps their addresses reserved. The pages are
+//zero if they are committed again.
+//p and size are assumed to be multiples of the system page size.
+void stz_memory_decommit (void* p, stz_long size) {
+  if (size && mmap(p, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+    exit_with_error();
+  if (size && (stz_huge_pages || stz_numa_policy)) advise_memory(p, size);
+}
+
+//Returns the pages from p (inclusive) to p + size (exclusive) to the
+//operating system. Unlike stz_memory_decommit, the pages stay committed,
+//and are zero when they are next touched.
+//p and size are assumed to be multiples of the system page size.
+void stz_memory_release (void* p, stz_long size) {
+#ifdef PLATFORM_LINUX
+  if (size && madvise(p, (size_t)size, MADV_DONTNEED))
+    exit_with_error();
+#else
+  if (size && mmap(p, (size_t)size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+    exit_with_error();
+  if (size && (stz_huge_pages || stz_numa_policy)) advise_memory(p, size);
+#endif
 }
 
 #endif
@@ -545,13 +818,25 @@ void* stz_memory_map (stz_long min_size, stz_long max_size) {
   if (p == NULL) exit_with_error();
 
   // Commit the min size with RWX access.
-  p = VirtualAlloc(p, (SIZE_T)min_size, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-  if (p == NULL) exit_with_error();
+  if (min_size > 0) {
+    p = VirtualAlloc(p, (SIZE_T)min_size, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+    if (p == NULL) exit_with_error();
+  }
 
   // Return the reserved and committed pointer.
   return p;
 }
 
+//Reserves a segment of memory for the frames of a stack. No pages are
+//committed.
+//This function is called from within Stanza, and size is assumed to be a
+//multiple of the system page size.
+void* stz_stack_map (stz_long size) {
+  void* p = VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+  if (p == NULL) exit_with_error();
+  return p;
+}
+
 //Unmaps given segment of memory.
 //This function is called from within Stanza, and size is
 //assumed to be a multiple of the system page size.
@@ -583,219 +868,61 @@ void stz_memory_resize (void* p, stz_long old_size, stz_long new_size) {
   }
 }
 
-#endif
-
-//============================================================
-//================= Process Runtime ==========================
-//============================================================
-#if defined(PLATFORM_OS_X) || defined(PLATFORM_LINUX)
-
-//------------------------------------------------------------
-//------------------- Structures -----------------------------
-//------------------------------------------------------------
-
-//- working_dir: If not null, the working directory of the
-//  new process.
-//- env_vars: If not null, the environment variables to set in the
-//  child process. Each string has format "MYVAR=MYVALUE" and is null-terminated.
-//- argvs: The string arguments that are passed to the C main function.
-typedef struct {
-  stz_byte* pipe;
-  stz_byte* in_pipe;
-  stz_byte* out_pipe;
-  stz_byte* err_pipe;
-  stz_byte* file;
-  stz_byte* working_dir;
-  stz_byte** env_vars;
-  stz_byte** argvs;
-} EvalArg;
-
-#define RETURN_NEG(x) {int r=(x); if(r < 0) return -1;}
-
-//------------------------------------------------------------
-//-------------------- Utilities -----------------------------
-//------------------------------------------------------------
-
-static int count_non_null (void** xs){
-  int n=0;
-  while(xs[n] != NULL)
-    n++;
-  return n;
+//Commits the pages from p (inclusive) to p + size (exclusive) of a
+//segment returned by stz_memory_map. The pages are zero when first committed.
+//p and size are assumed to be multiples of the system page size.
+void stz_memory_commit (void* p, stz_long size) {
+  if (size && !VirtualAlloc(p, (SIZE_T)size, MEM_COMMIT, PAGE_EXECUTE_READWRITE))
+    exit_with_error();
 }
 
-static char* string_join (const char* a, const char* b){
-  int len = strlen(a) + strlen(b);
-  char* buffer = (char*)stz_malloc(len + 1);
-  sprintf(buffer, "%s%s", a, b);
-  return buffer;
+//Releases the pages from p (inclusive) to p + size (exclusive) to the
+//operating system, but keeps their addresses reserved. The pages are
+//zero if they are committed again.
+//p and size are assumed to be multiples of the system page size.
+void stz_memory_decommit (void* p, stz_long size) {
+  if (size && !VirtualFree(p, (SIZE_T)size, MEM_DECOMMIT))
+    exit_with_error();
 }
 
-//Opening a named pipe
-static int open_pipe (const char* prefix, const char* suffix, int options){
-  char* name = string_join(prefix, suffix);
-  int fd = open(name, options);
-  stz_free(name);
-  return fd;
+//Returns the pages from p (inclusive) to p + size (exclusive) to the
+//operating system. Unlike stz_memory_decommit, the pages stay committed,
+//and are zero when they are next touched.
+//p and size are assumed to be multiples of the system page size.
+void stz_memory_release (void* p, stz_long size) {
+  stz_memory_decommit(p, size);
+  stz_memory_commit(p, size);
 }
 
-//Creating a named pipe
-static int make_pipe (char* prefix, char* suffix){
-  char* name = string_join(prefix, suffix);
-  return mkfifo(name, S_IRUSR|S_IWUSR);
-}
 #endif
 
-//------------------------------------------------------------
-//----------------------- Serialization ----------------------
-//------------------------------------------------------------
-#if defined(PLATFORM_LINUX) | defined(PLATFORM_OS_X)
-
-// ===== Serialization =====
-static void write_int (FILE* f, stz_int x){
-  fwrite(&x, sizeof(stz_int), 1, f);
-}
-static void write_long (FILE* f, stz_long x){
-  fwrite(&x, sizeof(stz_long), 1, f);
-}
-static void write_string (FILE* f, stz_byte* s){
-  if(s == NULL)
-    write_int(f, -1);
-  else{
-    size_t n = strlen(C_CSTR(s));
-    write_int(f, (stz_int)n);
-    fwrite(s, 1, n, f);
-  }
-}
-static void write_strings (FILE* f, stz_byte** s){
-  int n = count_non_null((void**)s);
-  write_int(f, (stz_int)n);
-  for(int i=0; i<n; i++)
-    write_string(f, s[i]);
-}
-
-//Write a list of strings. The list may be optional, and is
-//represented using NULL.
-static void write_optional_strings (FILE* f, stz_byte** s){
-  if(s == NULL){
-    write_int(f, 0);
-  }else{
-    write_int(f, 1);
-    write_strings(f, s);
-  }     
-}
-
-static void write_earg (FILE* f, EvalArg* earg){
-  write_string(f, earg->pipe);
-  write_string(f, earg->in_pipe);
-  write_string(f, earg->out_pipe);
-  write_string(f, earg->err_pipe);
-  write_string(f, earg->file);
-  write_string(f, earg->working_dir);
-  write_optional_strings(f, earg->env_vars);
-  write_strings(f, earg->argvs);
-}
-
-static void write_process_state (FILE* f, ProcessState* s){
-  write_int(f, s->state);
-  write_int(f, s->code);
-}
-
-// ===== Deserialization =====
-static void bread (void* xs0, int size, int n0, FILE* f){
-  char* xs = xs0;
-  int n = n0;
-  while(n > 0){
-    int c = fread(xs, size, n, f);
-    if(c < n){
-      if(ferror(f)) exit_with_error();
-      if(feof(f)) return;
-    }
-    n = n - c;
-    xs = xs + size*c;
-  }
-}
-static stz_int read_int (FILE* f){
-  stz_int n;
-  bread(&n, sizeof(stz_int), 1, f);
-  return n;
-}
-static stz_long read_long (FILE* f){
-  stz_long n;
-  bread(&n, sizeof(stz_long), 1, f);
-  return n;
-}
-static stz_byte* read_string (FILE* f){
-  stz_int n = read_int(f);
-  if(n < 0)
-    return NULL;
-  else{
-    stz_byte* s = (stz_byte*)stz_malloc(n + 1);
-    bread(s, 1, (int)n, f);
-    s[n] = '\0';
-    return s;
-  }
-}
-static stz_byte** read_strings (FILE* f){
-  stz_int n = read_int(f);
-  stz_byte** xs = (stz_byte**)stz_malloc(sizeof(stz_byte*)*(n + 1));
-  for(int i=0; i<n; i++)
-    xs[i] = read_string(f);
-  xs[n] = NULL;
-  return xs;
-}
-
-static stz_byte** read_optional_strings (FILE* f){
-  stz_int flag = read_int(f);
-  if(flag == 0){
-    return NULL;
-  }else{
-    return read_strings(f);
-  }
-}
+//============================================================
+//================= Process Runtime ==========================
+//============================================================
+#if defined(PLATFORM_OS_X) || defined(PLATFORM_LINUX)
+#include<spawn.h>
 
-static EvalArg* read_earg (FILE* f){
-  EvalArg* earg = (EvalArg*)stz_malloc(sizeof(EvalArg));
-  earg->pipe = read_string(f);
-  earg->in_pipe = read_string(f);
-  earg->out_pipe = read_string(f);
-  earg->err_pipe = read_string(f);
-  earg->file = read_string(f);
-  earg->working_dir = read_string(f);
-  earg->env_vars = read_optional_strings(f);
-  earg->argvs = read_strings(f);
-  return earg;
-}
-static void read_process_state (FILE* f, ProcessState* s){
-  s->state = read_int(f);
-  s->code = read_int(f);
-}
+extern char** environ;
 
-//===== Free =====
-static void free_strings (stz_byte** ss){
-  for(int i=0; ss[i] != NULL; i++)
-    stz_free(ss[i]);
-  stz_free(ss);
-}
-
-static void free_earg (EvalArg* arg){
-  stz_free(arg->pipe);
-  if(arg->in_pipe != NULL) stz_free(arg->in_pipe);
-  if(arg->out_pipe != NULL) stz_free(arg->out_pipe);
-  if(arg->err_pipe != NULL) stz_free(arg->err_pipe);
-  stz_free(arg->file);
-  if(arg->working_dir != NULL) stz_free(arg->working_dir);
-  if(arg->env_vars != NULL) free_strings(arg->env_vars);
-  free_strings(arg->argvs);
-  stz_free(arg);
-}
+//posix_spawn can change the working directory of the child where
+//posix_spawn_file_actions_addchdir_np is available. Elsewhere, processes
+//with a working directory are launched with fork and exec.
+#if defined(PLATFORM_OS_X) || \
+    (defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29)))
+  #define SPAWN_SUPPORTS_CHDIR
+#endif
 
 //------------------------------------------------------------
 //-------------------- Process Queries -----------------------
 //------------------------------------------------------------
 
-static void get_process_state (stz_long pid, ProcessState* s, int wait_for_termination){
+//Returns -1 if the process could not be waited for.
+static int get_process_state (stz_long pid, ProcessState* s, int wait_for_termination){
   int status;
-  int ret = waitpid((pid_t)pid, &status, wait_for_termination? 0 : WNOHANG);
+  int ret;
+  while((ret = waitpid((pid_t)pid, &status, wait_for_termination? 0 : WNOHANG)) < 0){
+    if(errno != EINTR) return -1;
+  }
 
   if(ret == 0)
     *s = (ProcessState){PROCESS_RUNNING, 0};
@@ -807,322 +934,809 @@ static void get_process_state (stz_long pid, ProcessState* s, int wait_for_termi
     *s = (ProcessState){PROCESS_STOPPED, WSTOPSIG(status)};
   else
     *s = (ProcessState){PROCESS_RUNNING, 0};
+  return 0;
 }
 
 //------------------------------------------------------------
-//----------------------- Execvpe ----------------------------
+//----------------------- Pipes ------------------------------
 //------------------------------------------------------------
-//The 'execvpe' frontend to 'execvp' does not exist in OS-X.
-//So implement a quick version of it.
-
-#ifdef PLATFORM_OS_X
-extern char **environ;
-int execvpe(const char *program, char **argv, char **envp){
-  char **saved = environ;
-  environ = envp;
-  int rc = execvp(program, argv);
-  environ = saved;
-  return rc;
+
+//Move a close-on-exec descriptor above the standard streams.
+//A pipe end that happens to be 0, 1 or 2, because this process closed
+//its own standard stream, would otherwise already equal its target in
+//the child, skip the dup2 that clears close-on-exec, and be closed.
+//Returns -1 and closes fd on failure.
+static int move_above_standard_streams (int fd){
+  if(fd > 2) return fd;
+  int moved = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+  int code = errno;
+  close(fd);
+  errno = code;
+  return moved;
 }
+
+//Create a pipe whose ends are closed when a process is launched,
+//so that children only inherit the ends that are duplicated onto
+//their standard streams.
+static int make_cloexec_pipe (int fds[2]){
+#ifdef PLATFORM_LINUX
+  if(pipe2(fds, O_CLOEXEC) < 0) return -1;
+#else
+  if(pipe(fds) < 0) return -1;
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
 #endif
+  fds[0] = move_above_standard_streams(fds[0]);
+  fds[1] = move_above_standard_streams(fds[1]);
+  if(fds[0] < 0 || fds[1] < 0){
+    int code = errno;
+    if(fds[0] >= 0) close(fds[0]);
+    if(fds[1] >= 0) close(fds[1]);
+    fds[0] = fds[1] = -1;
+    errno = code;
+    return -1;
+  }
+  return 0;
+}
+
+static void close_pipes (int pipes[NUM_STREAM_SPECS][2]){
+  for(int i=0; i<NUM_STREAM_SPECS; i++){
+    if(pipes[i][0] >= 0) close(pipes[i][0]);
+    if(pipes[i][1] >= 0) close(pipes[i][1]);
+  }
+}
+
+//Closes the streams to a process once it has finished.
+stz_int delete_process_pipes (FILE* input, FILE* output, FILE* error) {
+  if(input != NULL && fclose(input) == EOF) return -1;
+  if(output != NULL && fclose(output) == EOF) return -1;
+  if(error != NULL && fclose(error) == EOF) return -1;
+  return 0;
+}
 
 //------------------------------------------------------------
-//---------------------- Launcher Main -----------------------
+//---------------------- Launching ---------------------------
 //------------------------------------------------------------
 
-#define LAUNCH_COMMAND 0
-#define STATE_COMMAND 1
-#define WAIT_COMMAND 2
+//Launch the child with posix_spawnp.
+//sources[i] is the descriptor that the child uses as descriptor i.
+//Returns the new process id, or -1 and sets errno on failure.
+#ifdef SPAWN_SUPPORTS_CHDIR
+static stz_long spawn_child (stz_byte* file, stz_byte** argvs, int sources[3],
+                             stz_byte* working_dir, stz_byte** env_vars){
+  posix_spawn_file_actions_t actions;
+  int r = posix_spawn_file_actions_init(&actions);
+  if(r != 0){
+    errno = r;
+    return -1;
+  }
+  for(int i=0; i<3 && r == 0; i++){
+    if(sources[i] != i)
+      r = posix_spawn_file_actions_adddup2(&actions, sources[i], i);
+  }
+  if(r == 0 && working_dir != NULL)
+    r = posix_spawn_file_actions_addchdir_np(&actions, C_CSTR(working_dir));
+
+  pid_t pid;
+  if(r == 0){
+    char** envp = env_vars == NULL ? environ : (char**)env_vars;
+    r = posix_spawnp(&pid, C_CSTR(file), &actions, NULL, (char**)argvs, envp);
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  if(r != 0){
+    errno = r;
+    return -1;
+  }
+  return (stz_long)pid;
+}
 
+//Launch the child with fork and exec, for platforms where posix_spawn
+//cannot set the working directory.
+//Returns the new process id, or -1 and sets errno on failure.
+#else
 static void write_error_and_exit (int fd){
   int code = errno;
   write(fd, &code, sizeof(int));
   close(fd);
-  exit(-1);
+  _exit(-1);
+}
+
+static stz_long spawn_child (stz_byte* file, stz_byte** argvs, int sources[3],
+                             stz_byte* working_dir, stz_byte** env_vars){
+  //Create error-code pipe, whose write end is closed on successful exec.
+  int READ = 0;
+  int WRITE = 1;
+  int exec_error[2];
+  if(make_cloexec_pipe(exec_error) < 0) return -1;
+
+  pid_t pid = fork();
+  if(pid < 0){
+    close(exec_error[READ]);
+    close(exec_error[WRITE]);
+    return -1;
+  }
+
+  if(pid == 0){
+    for(int i=0; i<3; i++){
+      if(sources[i] != i && dup2(sources[i], i) < 0)
+        write_error_and_exit(exec_error[WRITE]);
+    }
+    if(working_dir != NULL && chdir(C_CSTR(working_dir)) < 0)
+      write_error_and_exit(exec_error[WRITE]);
+    if(env_vars == NULL)
+      execvp(C_CSTR(file), (char**)argvs);
+    else
+      execvpe(C_CSTR(file), (char**)argvs, (char**)env_vars);
+    write_error_and_exit(exec_error[WRITE]);
+  }
+
+  //Read from error-code pipe
+  close(exec_error[WRITE]);
+  int exec_code;
+  ssize_t exec_r;
+  while((exec_r = read(exec_error[READ], &exec_code, sizeof(int))) < 0 && errno == EINTR);
+  close(exec_error[READ]);
+  if(exec_r == sizeof(int)){
+    //Exec evaluated unsuccessfully. Reap the child and return its error.
+    waitpid(pid, NULL, 0);
+    errno = exec_code;
+    return -1;
+  }
+  return (stz_long)pid;
 }
+#endif
 
-static void disable_ctrl_c () {
-  #ifdef PLATFORM_WINDOWS
-    SetConsoleCtrlHandler(NULL, TRUE);
-  #else
-    signal(SIGINT, SIG_IGN);
-  #endif
+//Launch a process directly from this process.
+//The process inherits the standard streams of this process, except for
+//the ones that are connected to pipes by PROCESS_IN, PROCESS_OUT and PROCESS_ERR.
+//Returns -1 and sets errno on failure.
+stz_int launch_process(stz_byte* file, stz_byte** argvs, stz_int input,
+                       stz_int output, stz_int error,
+                       stz_byte* working_dir, stz_byte** env_vars, Process* process) {
+  //Create pipes to child. pipes[spec] holds the read and write end of the
+  //pipe for each stream specifier that is used.
+  int READ = 0;
+  int WRITE = 1;
+  int pipes[NUM_STREAM_SPECS][2];
+  for(int i=0; i<NUM_STREAM_SPECS; i++)
+    pipes[i][READ] = pipes[i][WRITE] = -1;
+  if(input == PROCESS_IN && make_cloexec_pipe(pipes[PROCESS_IN]) < 0)
+    goto fail;
+  if((output == PROCESS_OUT || error == PROCESS_OUT) && make_cloexec_pipe(pipes[PROCESS_OUT]) < 0)
+    goto fail;
+  if((output == PROCESS_ERR || error == PROCESS_ERR) && make_cloexec_pipe(pipes[PROCESS_ERR]) < 0)
+    goto fail;
+
+  //Compute the descriptors that the child uses as its standard streams.
+  int sources[3] = {0, 1, 2};
+  if(input == PROCESS_IN) sources[0] = pipes[PROCESS_IN][READ];
+  if(output == PROCESS_OUT || output == PROCESS_ERR) sources[1] = pipes[output][WRITE];
+  if(error == PROCESS_OUT || error == PROCESS_ERR) sources[2] = pipes[error][WRITE];
+
+  //Launch the child.
+  stz_long pid = spawn_child(file, argvs, sources, working_dir, env_vars);
+  if(pid < 0) goto fail;
+
+  //Close the child's ends of the pipes, and open the parent's ends.
+  process->in = NULL;
+  process->out = NULL;
+  process->err = NULL;
+  if(pipes[PROCESS_IN][READ] >= 0){
+    close(pipes[PROCESS_IN][READ]);
+    process->in = fdopen(pipes[PROCESS_IN][WRITE], "w");
+  }
+  if(pipes[PROCESS_OUT][WRITE] >= 0){
+    close(pipes[PROCESS_OUT][WRITE]);
+    process->out = fdopen(pipes[PROCESS_OUT][READ], "r");
+  }
+  if(pipes[PROCESS_ERR][WRITE] >= 0){
+    close(pipes[PROCESS_ERR][WRITE]);
+    process->err = fdopen(pipes[PROCESS_ERR][READ], "r");
+  }
+  process->pid = pid;
+  return 0;
+
+  fail:
+  {
+    int code = errno;
+    close_pipes(pipes);
+    errno = code;
+    return -1;
+  }
 }
 
-static void launcher_main (FILE* lin, FILE* lout){
-  disable_ctrl_c();
-  while(1){
-    //Read in command
-    int comm = fgetc(lin);
-    if(feof(lin)) exit(0);
-
-    //Interpret launch process command
-    if(comm == LAUNCH_COMMAND){
-      //Read in evaluation arguments
-      EvalArg* earg = read_earg(lin);
-      if(feof(lin)) exit(0);
-
-      //Create error-code pipe
-      int READ = 0;
-      int WRITE = 1;
-      int exec_error[2];
-      if(pipe(exec_error) < 0) exit_with_error();
-
-      //Fork a new child
-      stz_long pid = (stz_long)fork();
-      if(pid < 0) exit_with_error();
-
-      if(pid > 0){
-        //Read from error-code pipe
-        int exec_code;
-        close(exec_error[WRITE]);
-        int exec_r = read(exec_error[READ], &exec_code, sizeof(int));
-        close(exec_error[READ]);
-
-        if(exec_r == 0){
-          //Exec evaluated successfully
-          //Return new process id
-          write_long(lout, pid);
-          fflush(lout);
-        }
-        else if(exec_r == sizeof(int)){
-          //Exec evaluated unsuccessfully
-          //Return error code as negative long
-          write_long(lout, (stz_long)-exec_code);
-          fflush(lout);
-        }
-        else{
-          fprintf(stderr, "Unreachable code.");
-          exit(-1);
-        }
-      }else{
-        //Close exec pipe read, and close write end on successful exec
-        close(exec_error[READ]);
-        fcntl(exec_error[WRITE], F_SETFD, FD_CLOEXEC);
-
-        //Open named pipes
-        if(earg->in_pipe != NULL){
-          int fd = open_pipe(C_CSTR(earg->pipe), C_CSTR(earg->in_pipe), O_RDONLY);
-          if(fd < 0) write_error_and_exit(exec_error[WRITE]);
-          dup2(fd, 0);
-        }
-        if(earg->out_pipe != NULL){
-          int fd = open_pipe(C_CSTR(earg->pipe), C_CSTR(earg->out_pipe), O_WRONLY);
-          if(fd < 0) write_error_and_exit(exec_error[WRITE]);
-          dup2(fd, 1);
-        }
-        if(earg->err_pipe != NULL){
-          int fd = open_pipe(C_CSTR(earg->pipe), C_CSTR(earg->err_pipe), O_WRONLY);
-          if(fd < 0) write_error_and_exit(exec_error[WRITE]);
-          dup2(fd, 2);
-        }
+int retrieve_process_state (Process* process, ProcessState* s, stz_int wait_for_termination){
+  return get_process_state(process->pid, s, wait_for_termination);
+}
+#else
+#include "process-win32.c"
+//============================================================
+//============== End Process Runtime =========================
+//============================================================
+#endif
 
-        //Set the working directory of the child process if explicitly
-        //requested.
-        if (earg->working_dir) {
-          if (chdir(C_CSTR(earg->working_dir)) == -1) {
-            write_error_and_exit(exec_error[WRITE]);
-          }
-        }
+//============================================================
+//================== Parallel Marking ========================
+//============================================================
+//Used by the garbage collector to trace the object graph on
+//multiple threads during a full collection. Each object is claimed
+//by exactly one thread by setting its mark bit with an atomic
+//fetch-or. Every thread traces from a private stack of marked
+//objects, and publishes surplus work to a lock-protected deque from
+//which idle threads steal.
+
+//The following descriptors must match the layout used by the
+//class table in core.stanza.
+typedef struct {
+  stz_int layout;
+  stz_int num_base_bytes;
+  void* record;
+} ClassDescriptor;
 
-        //Launch child process.
-        //If an environment is supplied then call execvpe, otherwise call execvp.
-        if(earg->env_vars == NULL)
-          execvp(C_CSTR(earg->file), (char**)earg->argvs);
-        else
-          execvpe(C_CSTR(earg->file), (char**)earg->argvs, (char**)earg->env_vars);
+typedef struct {
+  stz_int num_bytes;
+  stz_int size;
+  stz_int item_size;
+  stz_int num_roots;
+  stz_int roots[];
+} ClassRecord;
 
-        //Unsuccessful exec, write error number
-        write_error_and_exit(exec_error[WRITE]);
-      }
-    }
-    //Interpret state retrieval command
-    else if(comm == STATE_COMMAND || comm == WAIT_COMMAND){
-      //Read in process id
-      stz_long pid = read_long(lin);
-
-      //Retrieve state
-      ProcessState s; get_process_state(pid, &s, comm == WAIT_COMMAND);
-      write_process_state(lout, &s);
-      fflush(lout);
-    }
-    //Unrecognized command
-    else{
-      fprintf(stderr, "Illegal command: %d\n", comm);
-      exit(-1);
+typedef struct {
+  stz_int num_bytes;
+  stz_int base_size;
+  stz_int item_size;
+  stz_int num_base_roots;
+  stz_int num_item_roots;
+  stz_int roots[];
+} ArrayRecord;
+
+enum {
+  FAST_LAYOUT_BASE_WITH_NO_REFS = 0,
+  FAST_LAYOUT_BASE_WITH_REFS = 1,
+  FAST_LAYOUT_ARRAY_1_BYTE_TAIL = 2,
+  FAST_LAYOUT_ARRAY_4_BYTE_TAIL = 3,
+  FAST_LAYOUT_ARRAY_8_BYTE_TAIL = 4,
+  FAST_LAYOUT_ARRAY_REF_TAIL = 5,
+  FAST_LAYOUT_GENERAL = 6
+};
+
+#define TAG_MASK_IN_HEADER ((STZ_LONG(1) << 17) - 1)
+
+//Publish work once the private stack holds more than this many objects.
+#define MARK_SHARE_THRESHOLD 64
+//Maximum number of objects taken from another thread's deque at once.
+#define MARK_STEAL_BATCH 256
+
+//Growable stack of marked objects whose children are not yet marked.
+typedef struct {
+  stz_long** items;
+  stz_long size;
+  stz_long capacity;
+} MarkStack;
+
+//Deque of objects shared with other threads. The owner pushes
+//to the tail, and threads take from the head.
+typedef struct {
+  pthread_mutex_t lock;
+  stz_long** items;
+  stz_long head;
+  stz_long tail;
+  stz_long capacity;
+} MarkDeque;
+
+struct ParallelMarker;
+
+typedef struct {
+  struct ParallelMarker* marker;
+  MarkStack local;
+  MarkDeque shared;
+  pthread_t thread;
+} MarkWorker;
+
+typedef struct ParallelMarker {
+  stz_long* bitset_base;
+  ClassDescriptor* class_table;
+  stz_long num_workers;
+  MarkWorker* workers;
+  //Number of workers that may still produce new work.
+  stz_long num_active;
+} ParallelMarker;
+
+static void mark_stack_push (MarkStack* s, stz_long* p) {
+  if(s->size == s->capacity){
+    s->capacity *= 2;
+    s->items = (stz_long**)realloc(s->items, s->capacity * sizeof(stz_long*));
+    if(s->items == NULL) exit_with_error();
+  }
+  s->items[s->size++] = p;
+}
+
+//Move the top n objects of the private stack to the tail of the deque.
+static void mark_deque_publish (MarkDeque* d, MarkStack* s, stz_long n) {
+  pthread_mutex_lock(&d->lock);
+  if(d->tail + n > d->capacity){
+    //Slide the live segment to the front, and grow if still too small.
+    stz_long len = d->tail - d->head;
+    memmove(d->items, d->items + d->head, len * sizeof(stz_long*));
+    d->head = 0;
+    d->tail = len;
+    if(len + n > d->capacity){
+      while(len + n > d->capacity) d->capacity *= 2;
+      d->items = (stz_long**)realloc(d->items, d->capacity * sizeof(stz_long*));
+      if(d->items == NULL) exit_with_error();
     }
   }
+  s->size -= n;
+  memcpy(d->items + d->tail, s->items + s->size, n * sizeof(stz_long*));
+  d->tail += n;
+  pthread_mutex_unlock(&d->lock);
+}
+
+//Take up to MARK_STEAL_BATCH objects (at most half when taking from another
+//thread) from the head of the deque into the private stack.
+//Returns the number of objects taken.
+static stz_long mark_deque_take (MarkDeque* d, MarkStack* s, int half) {
+  if(__atomic_load_n(&d->tail, __ATOMIC_RELAXED) == __atomic_load_n(&d->head, __ATOMIC_RELAXED))
+    return 0;
+  pthread_mutex_lock(&d->lock);
+  stz_long len = d->tail - d->head;
+  stz_long n = half ? (len + 1) / 2 : len;
+  if(n > MARK_STEAL_BATCH) n = MARK_STEAL_BATCH;
+  for(stz_long i=0; i<n; i++)
+    mark_stack_push(s, d->items[d->head + i]);
+  d->head += n;
+  if(d->head == d->tail){
+    d->head = 0;
+    d->tail = 0;
+  }
+  pthread_mutex_unlock(&d->lock);
+  return n;
 }
 
-static stz_long launcher_pid = -1;
-static FILE* launcher_in = NULL;
-static FILE* launcher_out = NULL;
-void initialize_launcher_process (){
-  if(launcher_pid < 0){
-    //Create pipes
-    int READ = 0;
-    int WRITE = 1;
-    int lin[2];
-    int lout[2];
-    if(pipe(lin) < 0) exit_with_error();
-    if(pipe(lout) < 0) exit_with_error();
-
-    //Fork
-    stz_long pid = (stz_long)fork();
-    if(pid < 0) exit_with_error();
-
-    if(pid > 0){
-      //Parent
-      launcher_pid = pid;
-      close(lin[READ]);
-      close(lout[WRITE]);
-      launcher_in = fdopen(lin[WRITE], "w");
-      if(launcher_in == NULL) exit_with_error();
-      launcher_out = fdopen(lout[READ], "r");
-      if(launcher_out == NULL) exit_with_error();
+//Atomically set the mark bit for the object at p.
+//Returns non-zero if the object was already marked.
+static inline stz_long test_and_set_mark_atomic (stz_long* bitset_base, stz_long* p) {
+  uint64_t bit_index = (uint64_t)p >> 3;
+  stz_long* word = bitset_base + (bit_index >> 6);
+  stz_long mask = STZ_LONG(1) << (bit_index & 63);
+  //Avoid the atomic operation if the object is already marked.
+  if(__atomic_load_n(word, __ATOMIC_RELAXED) & mask) return 1;
+  return __atomic_fetch_or(word, mask, __ATOMIC_RELAXED) & mask;
+}
+
+static inline void mark_reference (MarkWorker* w, stz_long* ref) {
+  stz_long v = *ref;
+  //Is this a reference to a Stanza heap object?
+  if((v & 7) == 1){
+    stz_long* p = (stz_long*)(v - 1);
+    if(!test_and_set_mark_atomic(w->marker->bitset_base, p))
+      mark_stack_push(&w->local, p);
+  }
+}
+
+//Mark all objects referenced by the object at p.
+//Mirrors iterate-references in core.stanza.
+static void mark_references (MarkWorker* w, stz_long* p) {
+  ClassDescriptor* d = &w->marker->class_table[*p & TAG_MASK_IN_HEADER];
+  stz_long* slots = p + 1;
+  switch(d->layout){
+  case FAST_LAYOUT_BASE_WITH_REFS: {
+    stz_long num_slots = d->num_base_bytes >> 3;
+    for(stz_long i=0; i<num_slots; i++)
+      mark_reference(w, &slots[i]);
+    break;
+  }
+  case FAST_LAYOUT_ARRAY_REF_TAIL: {
+    stz_long len = slots[0];
+    stz_long* tail = (stz_long*)((stz_byte*)slots + d->num_base_bytes);
+    for(stz_long i=0; i<len; i++)
+      mark_reference(w, &tail[i]);
+    break;
+  }
+  case FAST_LAYOUT_GENERAL: {
+    ClassRecord* class_rec = (ClassRecord*)d->record;
+    if(class_rec->item_size == 0){
+      for(stz_int i=0; i<class_rec->num_roots; i++)
+        mark_reference(w, &slots[class_rec->roots[i]]);
     }
     else{
-      //Child
-      close(lin[WRITE]);
-      close(lout[READ]);
-      FILE* fin = fdopen(lin[READ], "r");
-      if(fin == NULL) exit_with_error();
-      FILE* fout = fdopen(lout[WRITE], "w");
-      if(fout == NULL) exit_with_error();
-      launcher_main(fin, fout);
+      ArrayRecord* array_rec = (ArrayRecord*)class_rec;
+      stz_int num_base_roots = array_rec->num_base_roots;
+      for(stz_int i=0; i<num_base_roots; i++)
+        mark_reference(w, &slots[array_rec->roots[i]]);
+      stz_int num_item_roots = array_rec->num_item_roots;
+      if(num_item_roots > 0){
+        stz_byte* items = (stz_byte*)slots + array_rec->base_size;
+        stz_int* item_roots = &array_rec->roots[num_base_roots];
+        stz_long len = slots[0];
+        for(stz_long n=0; n<len; n++){
+          for(stz_int i=0; i<num_item_roots; i++)
+            mark_reference(w, (stz_long*)(items + item_roots[i]));
+          items += array_rec->item_size;
+        }
+      }
     }
+    break;
+  }
+  default:
+    //Remaining layouts contain no references.
+    break;
   }
 }
 
-static void make_pipe_name (char* pipe_name, int pipeid) {
-  sprintf(pipe_name, "/tmp/stanza_exec_pipe_%ld_%ld", (long)getpid(), (long)pipeid);
+//Take work from the worker's own deque, or steal from another worker.
+//Returns 1 if any work was found.
+static int find_mark_work (MarkWorker* w) {
+  ParallelMarker* m = w->marker;
+  if(mark_deque_take(&w->shared, &w->local, 0)) return 1;
+  stz_long self = w - m->workers;
+  for(stz_long i=1; i<m->num_workers; i++){
+    MarkWorker* victim = &m->workers[(self + i) % m->num_workers];
+    if(mark_deque_take(&victim->shared, &w->local, 1)) return 1;
+  }
+  return 0;
 }
 
-static int delete_process_pipe (FILE* fd, char* pipe_name, char* suffix) {
-  if (fd != NULL) {
-    int close_res = fclose(fd);
-    if (close_res == EOF) return -1;
-    char my_pipe_name[80];
-    sprintf(my_pipe_name, "%s%s", pipe_name, suffix);
-    int rm_res = remove(my_pipe_name);
-    if (rm_res < 0) return -1;
+static int any_mark_work (ParallelMarker* m) {
+  for(stz_long i=0; i<m->num_workers; i++){
+    MarkDeque* d = &m->workers[i].shared;
+    if(__atomic_load_n(&d->tail, __ATOMIC_RELAXED) != __atomic_load_n(&d->head, __ATOMIC_RELAXED))
+      return 1;
   }
   return 0;
 }
 
-stz_int delete_process_pipes (FILE* input, FILE* output, FILE* error, stz_int pipeid) {
-  char pipe_name[80];
-  make_pipe_name(pipe_name, (int)pipeid);
-  if (delete_process_pipe(input,  pipe_name, "_in") < 0)
-    return -1;
-  if (delete_process_pipe(output, pipe_name, "_out") < 0)
-    return -1;
-  if (delete_process_pipe(error,  pipe_name, "_err") < 0)
-    return -1;
-  return 0;
+static void* mark_worker_main (void* arg) {
+  MarkWorker* w = (MarkWorker*)arg;
+  ParallelMarker* m = w->marker;
+  while(1){
+    //Trace from the private stack, publishing surplus work
+    //whenever the shared deque runs dry.
+    while(w->local.size > 0){
+      stz_long* p = w->local.items[--w->local.size];
+      mark_references(w, p);
+      if(w->local.size > MARK_SHARE_THRESHOLD &&
+         __atomic_load_n(&w->shared.tail, __ATOMIC_RELAXED) == __atomic_load_n(&w->shared.head, __ATOMIC_RELAXED))
+        mark_deque_publish(&w->shared, &w->local, w->local.size / 2);
+    }
+    if(find_mark_work(w)) continue;
+
+    //Out of work. Marking is complete once every worker is idle,
+    //as only active workers can publish new work.
+    __atomic_sub_fetch(&m->num_active, 1, __ATOMIC_SEQ_CST);
+    while(1){
+      if(__atomic_load_n(&m->num_active, __ATOMIC_SEQ_CST) == 0) return NULL;
+      if(any_mark_work(m)){
+        __atomic_add_fetch(&m->num_active, 1, __ATOMIC_SEQ_CST);
+        if(find_mark_work(w)) break;
+        __atomic_sub_fetch(&m->num_active, 1, __ATOMIC_SEQ_CST);
+      }
+      sched_yield();
+    }
+  }
 }
 
-stz_int launch_process(stz_byte* file, stz_byte** argvs, stz_int input,
-                       stz_int output, stz_int error, stz_int pipeid,
-                       stz_byte* working_dir, stz_byte** env_vars, Process* process) {
-  //Initialize launcher if necessary
-  initialize_launcher_process();
+//Mark all objects reachable from the objects on the collector's marking
+//stack, which must already be marked themselves. The marking stack
+//grows downwards from stack_bottom to stack_top, and is left untouched.
+//- bitset_base: The bitset-base of the heap.
+//- class_table: The class table of the VMState.
+//- num_threads: The number of threads to use, including the calling thread.
+void stz_parallel_mark (stz_long** stack_top, stz_long** stack_bottom,
+                        stz_long* bitset_base, ClassDescriptor* class_table,
+                        stz_long num_threads) {
+  ParallelMarker m;
+  m.bitset_base = bitset_base;
+  m.class_table = class_table;
+  m.num_workers = num_threads < 1 ? 1 : num_threads;
+  m.workers = (MarkWorker*)stz_malloc(m.num_workers * sizeof(MarkWorker));
+  m.num_active = m.num_workers;
+
+  //Initialize the workers.
+  for(stz_long i=0; i<m.num_workers; i++){
+    MarkWorker* w = &m.workers[i];
+    w->marker = &m;
+    w->local.size = 0;
+    w->local.capacity = 1024;
+    w->local.items = (stz_long**)stz_malloc(w->local.capacity * sizeof(stz_long*));
+    pthread_mutex_init(&w->shared.lock, NULL);
+    w->shared.head = 0;
+    w->shared.tail = 0;
+    w->shared.capacity = 1024;
+    w->shared.items = (stz_long**)stz_malloc(w->shared.capacity * sizeof(stz_long*));
+  }
 
-  //Figure out unique pipe name
-  char pipe_name[80];
-  make_pipe_name(pipe_name, (int)pipeid);
+  //Distribute the initial gray objects round-robin across the workers.
+  stz_long i = 0;
+  for(stz_long** s = stack_top; s < stack_bottom; s++, i++)
+    mark_stack_push(&m.workers[i % m.num_workers].local, *s);
 
-  //Compute pipe sources
-  int pipe_sources[NUM_STREAM_SPECS];
-  for(int i=0; i<NUM_STREAM_SPECS; i++)
-    pipe_sources[i] = -1;
-  pipe_sources[input] = 0;
-  pipe_sources[output] = 1;
-  pipe_sources[error] = 2;
-
-  //Create pipes to child
-  if(pipe_sources[PROCESS_IN] >= 0)
-    RETURN_NEG(make_pipe(pipe_name, "_in"))
-  if(pipe_sources[PROCESS_OUT] >= 0)
-    RETURN_NEG(make_pipe(pipe_name, "_out"))
-  if(pipe_sources[PROCESS_ERR] >= 0)
-    RETURN_NEG(make_pipe(pipe_name, "_err"))
-
-  //Write in command and evaluation arguments
-  EvalArg earg = {STZ_STR(pipe_name), NULL, NULL, NULL, file, working_dir, env_vars, argvs};
-  if(input == PROCESS_IN) earg.in_pipe = STZ_STR("_in");
-  if(output == PROCESS_OUT) earg.out_pipe = STZ_STR("_out");
-  if(output == PROCESS_ERR) earg.out_pipe = STZ_STR("_err");
-  if(error == PROCESS_OUT) earg.err_pipe = STZ_STR("_out");
-  if(error == PROCESS_ERR) earg.err_pipe = STZ_STR("_err");
-  int r = fputc(LAUNCH_COMMAND, launcher_in);
-  if(r == EOF) return -1;
-  write_earg(launcher_in, &earg);
-  fflush(launcher_in);
-
-  //Open pipes to child
-  FILE* fin = NULL;
-  if(pipe_sources[PROCESS_IN] >= 0){
-    int fd = open_pipe(pipe_name, "_in", O_WRONLY);
-    RETURN_NEG(fd)
-    fin = fdopen(fd, "w");
-    if(fin == NULL) return -1;
-  }
-  FILE* fout = NULL;
-  if(pipe_sources[PROCESS_OUT] >= 0){
-    int fd = open_pipe(pipe_name, "_out", O_RDONLY);
-    RETURN_NEG(fd)
-    fout = fdopen(fd, "r");
-    if(fout == NULL) return -1;
-  }
-  FILE* ferr = NULL;
-  if(pipe_sources[PROCESS_ERR] >= 0){
-    int fd = open_pipe(pipe_name, "_err", O_RDONLY);
-    RETURN_NEG(fd)
-    ferr = fdopen(fd, "r");
-    if(ferr == NULL) return -1;
-  }
-
-  //Read back process id, and set errno if failed
-  stz_long pid = read_long(launcher_out);
-  if(pid < 0){
-    errno = (int)(- pid);
-    return -1;
+  //Launch helper threads. The calling thread acts as the first worker.
+  for(stz_long i=1; i<m.num_workers; i++)
+    if(pthread_create(&m.workers[i].thread, NULL, mark_worker_main, &m.workers[i]) != 0)
+      exit_with_error();
+  mark_worker_main(&m.workers[0]);
+  for(stz_long i=1; i<m.num_workers; i++)
+    pthread_join(m.workers[i].thread, NULL);
+
+  //Release the work queues.
+  for(stz_long i=0; i<m.num_workers; i++){
+    MarkWorker* w = &m.workers[i];
+    pthread_mutex_destroy(&w->shared.lock);
+    stz_free(w->local.items);
+    stz_free(w->shared.items);
   }
+  stz_free(m.workers);
+}
 
-  //Return process structure
-  process->pid = pid;
-  process->in = fin;
-  process->out = fout;
-  process->err = ferr;
-  return 0;
+//============================================================
+//================= Parallel Compaction ======================
+//============================================================
+//Used by the garbage collector to slide the live ranges of the heap
+//down to their final locations on multiple threads. The live ranges
+//are grouped into fixed-size regions of the heap. The destination of
+//each region is the prefix sum of the live bytes in the regions below
+//it, so a region can be moved as soon as every region whose source
+//overlaps its destination has been moved.
+
+#define COMPACTION_REGION_SIZE (STZ_LONG(1) << 20)
+
+//Must match LiveRange in core.stanza.
+typedef struct {
+  stz_long* live;
+  stz_long* dead;
+} LiveRange;
+
+typedef struct {
+  //Live ranges [first, last) start within this region.
+  stz_long first;
+  stz_long last;
+  //End of the last live range in the region.
+  stz_byte* source_end;
+  //Destination of the first live range in the region.
+  stz_byte* dest;
+  //Set once the region has been moved.
+  stz_long done;
+} CompactionRegion;
+
+typedef struct {
+  LiveRange* ranges;
+  CompactionRegion* regions;
+  stz_long num_regions;
+  //Index of the next region to be claimed by a thread.
+  stz_long next_region;
+  ClassDescriptor* class_table;
+} ParallelCompactor;
+
+static stz_long object_size_on_heap (stz_long size) {
+  return (size + 15) & -8;
+}
+
+//Return the total size of the object at p.
+//Mirrors allocation-size in core.stanza.
+static stz_long heap_object_size (ClassDescriptor* class_table, stz_long* p) {
+  ClassDescriptor* d = &class_table[*p & TAG_MASK_IN_HEADER];
+  stz_long len = p[1];
+  switch(d->layout){
+  case FAST_LAYOUT_BASE_WITH_NO_REFS:
+  case FAST_LAYOUT_BASE_WITH_REFS:
+    return object_size_on_heap(d->num_base_bytes);
+  case FAST_LAYOUT_ARRAY_1_BYTE_TAIL:
+    return object_size_on_heap(d->num_base_bytes + len);
+  case FAST_LAYOUT_ARRAY_4_BYTE_TAIL:
+    return object_size_on_heap(d->num_base_bytes + (len << 2));
+  case FAST_LAYOUT_ARRAY_8_BYTE_TAIL:
+  case FAST_LAYOUT_ARRAY_REF_TAIL:
+    return object_size_on_heap(d->num_base_bytes + (len << 3));
+  default: {
+    ClassRecord* class_rec = (ClassRecord*)d->record;
+    if(class_rec->item_size == 0)
+      return object_size_on_heap(class_rec->size);
+    ArrayRecord* array_rec = (ArrayRecord*)class_rec;
+    return object_size_on_heap(array_rec->base_size + array_rec->item_size * len);
+  }
+  }
 }
 
-int retrieve_process_state (Process* process, ProcessState* s, stz_int wait_for_termination){
-  stz_int pid = process->pid;
-  
-  //Check whether launcher has been initialized
-  if(launcher_pid < 0){
-    fprintf(stderr, "Launcher not initialized.\n");
-    exit(-1);
+static void compact_region (ParallelCompactor* c, CompactionRegion* r) {
+  //Wait for the regions below whose sources overlap our destination.
+  for(CompactionRegion* below = r - 1; below >= c->regions && below->source_end > r->dest; below--)
+    while(!__atomic_load_n(&below->done, __ATOMIC_ACQUIRE))
+      sched_yield();
+
+  stz_byte* dest = r->dest;
+  for(stz_long i=r->first; i<r->last; i++){
+    LiveRange* range = &c->ranges[i];
+    //Clear the relocation offsets stored in the object headers.
+    for(stz_long* p = range->live; p < range->dead; p = (stz_long*)((stz_byte*)p + heap_object_size(c->class_table, p)))
+      *p &= TAG_MASK_IN_HEADER;
+    //Slide the live range down. The source and destination may overlap.
+    stz_long size = (stz_byte*)range->dead - (stz_byte*)range->live;
+    memmove(dest, range->live, size);
+    dest += size;
   }
+  __atomic_store_n(&r->done, 1, __ATOMIC_RELEASE);
+}
 
-  //Send command
-  int r = fputc(wait_for_termination? WAIT_COMMAND : STATE_COMMAND, launcher_in);
-  if(r == EOF) exit_with_error();
-  write_long(launcher_in, pid);
-  fflush(launcher_in);
+static void* compaction_worker_main (void* arg) {
+  ParallelCompactor* c = (ParallelCompactor*)arg;
+  while(1){
+    //Regions are claimed in ascending order, so every region
+    //waited upon has already been claimed by some thread.
+    stz_long i = __atomic_fetch_add(&c->next_region, 1, __ATOMIC_RELAXED);
+    if(i >= c->num_regions) return NULL;
+    compact_region(c, &c->regions[i]);
+  }
+}
 
-  //Read back process state
-  read_process_state(launcher_out, s);
-  return 0;
+//Slide the given live ranges down to the compaction start, and clear
+//the relocation offsets in the headers of the moved objects.
+//Returns the new top of the heap.
+//- ranges: The live ranges in ascending order.
+//- compaction_start: The address of the first dead object.
+//- class_table: The class table of the VMState.
+//- num_threads: The number of threads to use, including the calling thread.
+stz_byte* stz_parallel_compact (LiveRange* ranges, stz_long num_ranges,
+                                stz_byte* compaction_start, ClassDescriptor* class_table,
+                                stz_long num_threads) {
+  ParallelCompactor c;
+  c.ranges = ranges;
+  c.class_table = class_table;
+  c.next_region = 0;
+  c.num_regions = 0;
+  c.regions = (CompactionRegion*)stz_malloc((num_ranges + 1) * sizeof(CompactionRegion));
+
+  //Group the live ranges into regions, and compute the destination
+  //of each region from the live bytes below it.
+  stz_byte* dest = compaction_start;
+  for(stz_long i=0; i<num_ranges; i++){
+    uint64_t region_index = (uint64_t)ranges[i].live / COMPACTION_REGION_SIZE;
+    if(c.num_regions == 0 ||
+       (uint64_t)ranges[c.regions[c.num_regions - 1].first].live / COMPACTION_REGION_SIZE != region_index){
+      CompactionRegion* r = &c.regions[c.num_regions++];
+      r->first = i;
+      r->dest = dest;
+      r->done = 0;
+    }
+    CompactionRegion* r = &c.regions[c.num_regions - 1];
+    r->last = i + 1;
+    r->source_end = (stz_byte*)ranges[i].dead;
+    dest += (stz_byte*)ranges[i].dead - (stz_byte*)ranges[i].live;
+  }
+
+  //Launch helper threads. The calling thread acts as the first worker.
+  stz_long num_helpers = num_threads - 1;
+  if(num_helpers > c.num_regions - 1) num_helpers = c.num_regions - 1;
+  if(num_helpers < 0) num_helpers = 0;
+  pthread_t* helpers = (pthread_t*)stz_malloc((num_helpers + 1) * sizeof(pthread_t));
+  for(stz_long i=0; i<num_helpers; i++)
+    if(pthread_create(&helpers[i], NULL, compaction_worker_main, &c) != 0)
+      exit_with_error();
+  compaction_worker_main(&c);
+  for(stz_long i=0; i<num_helpers; i++)
+    pthread_join(helpers[i], NULL);
+
+  stz_free(helpers);
+  stz_free(c.regions);
+  return dest;
 }
-#else
-#include "process-win32.c"
+
 //============================================================
-//============== End Process Runtime =========================
+//================== Allocation Profile ======================
 //============================================================
-#endif
+
+//The sampling allocation profiler in core.stanza reports each sample as a
+//folded stack: the frames from the outermost call down to the allocation,
+//followed by the type of the allocated object, separated by ';'.
+//Samples with the same stack are aggregated into one AllocationSite, and the
+//profile is written with one "<stack> <bytes>" line per site. This is the
+//format read by flamegraph.pl and by pprof.
+
+typedef struct {
+  char* stack;
+  uint64_t hash;
+  stz_long samples;
+  stz_long bytes;
+} AllocationSite;
+
+//Open addressing hash table of sites. The capacity is a power of two.
+static AllocationSite* allocation_sites = NULL;
+static stz_long num_allocation_sites = 0;
+static stz_long allocation_sites_capacity = 0;
+
+//The file that the profile is written to at exit. NULL if none.
+static char* allocation_profile_file = NULL;
+
+static uint64_t hash_allocation_stack (const char* stack) {
+  uint64_t h = 14695981039346656037ULL;
+  for(const char* c = stack; *c != '\0'; c++)
+    h = (h ^ (unsigned char)*c) * 1099511628211ULL;
+  return h;
+}
+
+//Return the site with the given stack, or the empty slot where it belongs.
+static AllocationSite* find_allocation_site (AllocationSite* sites, stz_long capacity,
+                                             const char* stack, uint64_t hash) {
+  stz_long i = (stz_long)(hash & (uint64_t)(capacity - 1));
+  while(sites[i].stack != NULL &&
+        (sites[i].hash != hash || strcmp(sites[i].stack, stack) != 0))
+    i = (i + 1) & (capacity - 1);
+  return &sites[i];
+}
+
+static void grow_allocation_sites (void) {
+  stz_long capacity = allocation_sites_capacity == 0 ? 1024 : allocation_sites_capacity * 2;
+  AllocationSite* sites = (AllocationSite*)calloc(capacity, sizeof(AllocationSite));
+  if(sites == NULL) exit_with_error();
+  for(stz_long i=0; i<allocation_sites_capacity; i++){
+    AllocationSite* s = &allocation_sites[i];
+    if(s->stack != NULL)
+      *find_allocation_site(sites, capacity, s->stack, s->hash) = *s;
+  }
+  free(allocation_sites);
+  allocation_sites = sites;
+  allocation_sites_capacity = capacity;
+}
+
+//Add a sample standing for the given number of allocated bytes.
+stz_int stz_record_allocation_sample (const stz_byte* stack, stz_long bytes) {
+  if(2 * (num_allocation_sites + 1) > allocation_sites_capacity)
+    grow_allocation_sites();
+  uint64_t hash = hash_allocation_stack((const char*)stack);
+  AllocationSite* site = find_allocation_site(allocation_sites, allocation_sites_capacity,
+                                              (const char*)stack, hash);
+  if(site->stack == NULL){
+    site->stack = strdup((const char*)stack);
+    if(site->stack == NULL) exit_with_error();
+    site->hash = hash;
+    num_allocation_sites++;
+  }
+  site->samples++;
+  site->bytes += bytes;
+  return 0;
+}
+
+//Write the profile to the given file. Returns -1 if it could not be written.
+stz_int stz_write_allocation_profile (const stz_byte* filename) {
+  FILE* f = fopen((const char*)filename, "w");
+  if(f == NULL) return -1;
+  for(stz_long i=0; i<allocation_sites_capacity; i++){
+    AllocationSite* s = &allocation_sites[i];
+    if(s->stack != NULL)
+      fprintf(f, "%s %lld\n", s->stack, (long long)s->bytes);
+  }
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+//Write the profile to the file given to stz_set_allocation_profile_file,
+//so that it is not written again at exit.
+//Returns -1 if it could not be written.
+stz_int stz_flush_allocation_profile (void) {
+  if(allocation_profile_file == NULL) return 0;
+  stz_int result = stz_write_allocation_profile((stz_byte*)allocation_profile_file);
+  free(allocation_profile_file);
+  allocation_profile_file = NULL;
+  return result;
+}
+
+static void write_allocation_profile_at_exit (void) {
+  if(allocation_profile_file != NULL &&
+     stz_write_allocation_profile((stz_byte*)allocation_profile_file) != 0)
+    fprintf(stderr, "Could not write allocation profile to %s.\n", allocation_profile_file);
+}
+
+//Set the file that the profile is written to when the program exits.
+stz_int stz_set_allocation_profile_file (const stz_byte* filename) {
+  static bool registered_exit_handler = false;
+  free(allocation_profile_file);
+  allocation_profile_file = strdup((const char*)filename);
+  if(allocation_profile_file == NULL) exit_with_error();
+  if(!registered_exit_handler){
+    atexit(write_allocation_profile_at_exit);
+    registered_exit_handler = true;
+  }
+  return 0;
+}
 
 #define STACK_TYPE 6
 
@@ -1134,6 +1748,203 @@ stz_int input_argc;
 stz_byte** input_argv;
 stz_int input_argv_needs_free;
 
+//     Runtime Configuration
+//     =====================
+//The runtime options are read before the program starts, first from the
+//environment variable STZ_RUNTIME_<OPTION>, and then from the command line
+//argument --stz-runtime-<option>=<value>. The command line arguments are
+//removed before the program sees them. The options are:
+//  initial-heap: Initial size of the heap in bytes.
+//  max-heap: Maximum size of the heap in bytes. This much address space is reserved.
+//  nursery: Nursery sizing policy, either "fixed" or "adaptive".
+//  nursery-fraction: The fixed nursery is sized to be heap size / nursery-fraction.
+//  marking-stack: Number of entries in the marking stack.
+//  stack-size: Initial size of coroutine stacks in bytes.
+//  alloc-profile: Run the allocation profiler, and write the profile to this file at exit.
+//  alloc-sample-interval: Number of bytes allocated between samples of the allocation profiler.
+//  large-object-space: Address space reserved for large objects, or 0 to allocate them in the heap.
+//  huge-pages: Either "on" or "off". If on, the heap, its bitset and the marking stack are
+//    aligned to 2MB and backed by transparent huge pages where the OS supports them.
+//  numa: NUMA placement of the same memory on Linux. Either "default", "interleave" to
+//    interleave it across the online nodes, or the number of a node to bind it to.
+//  uncommit-delay: Milliseconds after which an idle heap is shrunk and its free pages are
+//    returned to the OS, or 0 to keep them. A plain number, without a suffix.
+//Sizes may end with a K, M, or G suffix.
+//The values are also read by the Runtime Configuration section of core.stanza.
+stz_long stz_initial_heap_size = 8 * 1024 * 1024;
+stz_long stz_max_heap_size = STZ_LONG(8) * 1024 * 1024 * 1024;
+stz_long stz_adaptive_nursery = 0;
+stz_long stz_nursery_fraction = 8;
+stz_long stz_marking_stack_size = 1024 * 1024;
+stz_long stz_initial_stack_size = 4 * 1024;
+stz_long stz_alloc_profiling = 0;
+stz_long stz_alloc_sample_interval = 512 * 1024;
+stz_long stz_large_object_space_size = STZ_LONG(8) * 1024 * 1024 * 1024;
+stz_long stz_huge_pages = 0;
+//0 for the default policy, 1 to interleave, and 2 to bind to stz_numa_node.
+stz_long stz_numa_policy = 0;
+stz_long stz_numa_node = 0;
+stz_long stz_heap_uncommit_delay = 0;
+
+//A page of the dirty card summary covers 16MB of heap.
+#define LARGE_OBJECT_SPACE_ALIGNMENT (STZ_LONG(16) * 1024 * 1024)
+
+static const char* RUNTIME_OPTIONS[] = {
+  "initial-heap", "max-heap", "nursery", "nursery-fraction", "marking-stack", "stack-size",
+  "alloc-profile", "alloc-sample-interval", "large-object-space", "huge-pages", "numa",
+  "uncommit-delay", NULL
+};
+static const char RUNTIME_OPTION_PREFIX[] = "--stz-runtime-";
+static const char RUNTIME_ENV_PREFIX[] = "STZ_RUNTIME_";
+
+static void invalid_runtime_option (const char* name, const char* value) {
+  fprintf(stderr, "Invalid value for runtime option %s: %s.\n", name, value);
+  exit(-1);
+}
+
+//Parse a positive size with an optional K, M, or G suffix.
+//Returns false if the string is not a valid size.
+static bool parse_runtime_size (const char* str, stz_long* result) {
+  char* end;
+  errno = 0;
+  long long value = strtoll(str, &end, 10);
+  if(errno != 0 || end == str || value <= 0) return false;
+  int shift = 0;
+  switch(*end){
+  case 'k': case 'K': shift = 10; end++; break;
+  case 'm': case 'M': shift = 20; end++; break;
+  case 'g': case 'G': shift = 30; end++; break;
+  }
+  if(*end != '\0' || value > (INT64_MAX >> shift)) return false;
+  *result = (stz_long)value << shift;
+  return true;
+}
+
+//Set the runtime option with the given name.
+//Returns false if there is no option with that name.
+static bool set_runtime_option (const char* name, const char* value) {
+  stz_long* size;
+  if(strcmp(name, "initial-heap") == 0) size = &stz_initial_heap_size;
+  else if(strcmp(name, "max-heap") == 0) size = &stz_max_heap_size;
+  else if(strcmp(name, "nursery-fraction") == 0) size = &stz_nursery_fraction;
+  else if(strcmp(name, "marking-stack") == 0) size = &stz_marking_stack_size;
+  else if(strcmp(name, "stack-size") == 0) size = &stz_initial_stack_size;
+  else if(strcmp(name, "alloc-sample-interval") == 0) size = &stz_alloc_sample_interval;
+  else if(strcmp(name, "uncommit-delay") == 0){
+    char* end;
+    errno = 0;
+    long long delay = strtoll(value, &end, 10);
+    if(errno != 0 || end == value || *end != '\0' || delay < 0 || delay > INT64_MAX / 1000)
+      invalid_runtime_option(name, value);
+    stz_heap_uncommit_delay = (stz_long)delay;
+    return true;
+  }
+  else if(strcmp(name, "large-object-space") == 0){
+    if(strcmp(value, "0") == 0){
+      stz_large_object_space_size = 0;
+      return true;
+    }
+    size = &stz_large_object_space_size;
+  }
+  else if(strcmp(name, "alloc-profile") == 0){
+    if(*value == '\0') invalid_runtime_option(name, value);
+    stz_set_allocation_profile_file((const stz_byte*)value);
+    stz_alloc_profiling = 1;
+    return true;
+  }
+  else if(strcmp(name, "huge-pages") == 0){
+    if(strcmp(value, "off") == 0) stz_huge_pages = 0;
+    else if(strcmp(value, "on") == 0) stz_huge_pages = 1;
+    else invalid_runtime_option(name, value);
+    return true;
+  }
+  else if(strcmp(name, "numa") == 0){
+    char* end;
+    if(strcmp(value, "default") == 0) stz_numa_policy = 0;
+    else if(strcmp(value, "interleave") == 0) stz_numa_policy = 1;
+    else{
+      long node = strtol(value, &end, 10);
+      if(end == value || *end != '\0' || node < 0 || node >= 64)
+        invalid_runtime_option(name, value);
+      stz_numa_policy = 2;
+      stz_numa_node = node;
+    }
+    return true;
+  }
+  else if(strcmp(name, "nursery") == 0){
+    if(strcmp(value, "fixed") == 0) stz_adaptive_nursery = 0;
+    else if(strcmp(value, "adaptive") == 0) stz_adaptive_nursery = 1;
+    else invalid_runtime_option(name, value);
+    return true;
+  }
+  else return false;
+  if(!parse_runtime_size(value, size))
+    invalid_runtime_option(name, value);
+  return true;
+}
+
+//Read the runtime options from the environment and the command line.
+//The runtime options are removed from argv, and the new number of
+//arguments is returned.
+static int read_runtime_configuration (int argc, char* argv[]) {
+  //Read the environment variables.
+  for(int i = 0; RUNTIME_OPTIONS[i] != NULL; i++){
+    char env_name[64];
+    const char* name = RUNTIME_OPTIONS[i];
+    int n = sprintf(env_name, "%s", RUNTIME_ENV_PREFIX);
+    for(const char* c = name; *c != '\0'; c++)
+      env_name[n++] = *c == '-' ? '_' : toupper(*c);
+    env_name[n] = '\0';
+    const char* value = getenv(env_name);
+    if(value != NULL) set_runtime_option(name, value);
+  }
+
+  //Read and remove the command line arguments.
+  const size_t prefix_length = strlen(RUNTIME_OPTION_PREFIX);
+  int new_argc = 0;
+  for(int i = 0; i < argc; i++){
+    if(i > 0 && strncmp(argv[i], RUNTIME_OPTION_PREFIX, prefix_length) == 0){
+      char* name = argv[i] + prefix_length;
+      char* value = strchr(name, '=');
+      if(value == NULL){
+        fprintf(stderr, "Missing value for runtime option %s.\n", name);
+        exit(-1);
+      }
+      *value++ = '\0';
+      if(!set_runtime_option(name, value)){
+        fprintf(stderr, "Unknown runtime option %s.\n", name);
+        exit(-1);
+      }
+    }
+    else{
+      argv[new_argc++] = argv[i];
+    }
+  }
+  argv[new_argc] = NULL;
+
+  //Ensure that the options are consistent.
+  if(stz_initial_heap_size > stz_max_heap_size){
+    fprintf(stderr, "Initial heap size (%lld) exceeds maximum heap size (%lld).\n",
+            (long long)stz_initial_heap_size, (long long)stz_max_heap_size);
+    exit(-1);
+  }
+  if(stz_nursery_fraction < 2){
+    fprintf(stderr, "Nursery fraction must be at least 2.\n");
+    exit(-1);
+  }
+  if(stz_initial_stack_size < 1024){
+    fprintf(stderr, "Initial stack size must be at least 1024 bytes.\n");
+    exit(-1);
+  }
+  //Stack sizes are whole longs.
+  stz_initial_stack_size = (stz_initial_stack_size + 7) & ~STZ_LONG(7);
+  //The large-object space is whole alignment units, so that its part of the
+  //bitset and of the dirty card summary ends at a page boundary.
+  stz_large_object_space_size = (stz_large_object_space_size + LARGE_OBJECT_SPACE_ALIGNMENT - 1)
+                              & ~(LARGE_OBJECT_SPACE_ALIGNMENT - 1);
+  return new_argc;
+}
+
 //     Main Driver
 //     ===========
 static void* alloc (VMInit* init, long tag, long size){
@@ -1145,7 +1956,8 @@ static void* alloc (VMInit* init, long tag, long size){
 
 static Stack* alloc_stack (VMInit* init){
   Stack* stack = alloc(init, STACK_TYPE, sizeof(Stack));
-  stz_long initial_stack_size = 8 * 1024;
+  //The entry stacks start out twice as large as coroutine stacks.
+  stz_long initial_stack_size = 2 * stz_initial_stack_size;
   StackFrame* frames = (StackFrame*)stz_malloc(initial_stack_size);
   stack->size = initial_stack_size;
   stack->frames = frames;
@@ -1165,7 +1977,9 @@ enum {
   LOG_BYTES_IN_LONG = 3,
   LOG_BITS_IN_LONG = LOG_BYTES_IN_LONG + LOG_BITS_IN_BYTE,
   BYTES_IN_LONG = 1 << LOG_BYTES_IN_LONG,
-  BITS_IN_LONG = 1 << LOG_BITS_IN_LONG
+  BITS_IN_LONG = 1 << LOG_BITS_IN_LONG,
+  LOG_BYTES_IN_CARD = LOG_BITS_IN_LONG + LOG_BYTES_IN_LONG,
+  BYTES_IN_CARD = 1 << LOG_BYTES_IN_CARD
 };
 
 #define SYSTEM_PAGE_SIZE 4096ULL
@@ -1178,23 +1992,37 @@ static stz_long bitset_size (stz_long heap_size) {
   return ROUND_UP_TO_WHOLE_PAGES(bitset_size_in_longs << LOG_BYTES_IN_LONG);
 }
 
+//A card spans the heap bytes covered by one long of the bitset.
+//One extra long is reserved because the heap start is not aligned
+//to the span of a summary long.
+static stz_long dirty_cards_size (stz_long heap_size) {
+  uint64_t num_cards = (heap_size + (BYTES_IN_CARD - 1)) >> LOG_BYTES_IN_CARD;
+  uint64_t dirty_cards_size_in_longs = ((num_cards + (BITS_IN_LONG - 1)) >> LOG_BITS_IN_LONG) + 1;
+  return ROUND_UP_TO_WHOLE_PAGES(dirty_cards_size_in_longs << LOG_BYTES_IN_LONG);
+}
+
 STANZA_API_FUNC int main (int argc, char* argv[]) {
+  argc = read_runtime_configuration(argc, argv);
   input_argc = (stz_int)argc;
   input_argv = (stz_byte **)argv;
   input_argv_needs_free = 0;
   VMInit init;
 
   //Allocate heap
-  const stz_long min_heap_size = ROUND_UP_TO_WHOLE_PAGES(8 * 1024 * 1024);
-  const stz_long max_heap_size = ROUND_UP_TO_WHOLE_PAGES(STZ_LONG(8) * 1024 * 1024 * 1024);
-  init.heap_start = (stz_byte*)stz_memory_map(min_heap_size, max_heap_size);
+  //The large-object space is reserved directly below the heap, so that the
+  //bitset and the dirty card summary of the heap extend downwards over it.
+  const stz_long large_object_space_size = stz_large_object_space_size;
+  const stz_long min_heap_size = ROUND_UP_TO_WHOLE_PAGES(stz_initial_heap_size);
+  const stz_long max_heap_size = ROUND_UP_TO_WHOLE_PAGES(stz_max_heap_size);
+  stz_byte* heap_space = (stz_byte*)stz_memory_map(0, large_object_space_size + max_heap_size);
+  init.heap_start = heap_space + large_object_space_size;
+  stz_memory_commit(init.heap_start, min_heap_size);
   init.heap_max_size = max_heap_size;
   init.heap_size_limit = max_heap_size;
   init.heap_size = min_heap_size;
 
   //Setup the nursery
-  const stz_long nursery_fraction = 8; // Must match the value in core.stanza
-  const stz_long nursery_size = ROUND_UP_TO_WHOLE_LONGS(min_heap_size / nursery_fraction / 2);
+  const stz_long nursery_size = ROUND_UP_TO_WHOLE_LONGS(min_heap_size / stz_nursery_fraction / 2);
   init.heap_old_objects_end = init.heap_start;
   init.heap_top = init.heap_old_objects_end + nursery_size;
   init.heap_limit = init.heap_top + nursery_size;
@@ -1202,7 +2030,10 @@ STANZA_API_FUNC int main (int argc, char* argv[]) {
   //Allocate bitset for heap
   const stz_long min_bitset_size = bitset_size(min_heap_size);
   const stz_long max_bitset_size = bitset_size(max_heap_size);
-  init.heap_bitset = (stz_byte*)stz_memory_map(min_bitset_size, max_bitset_size);
+  const stz_long large_object_bitset_size = large_object_space_size >> (LOG_BYTES_IN_LONG + LOG_BITS_IN_LONG);
+  stz_byte* bitset_space = (stz_byte*)stz_memory_map(0, large_object_bitset_size + max_bitset_size);
+  init.heap_bitset = bitset_space + large_object_bitset_size;
+  stz_memory_commit(init.heap_bitset, min_bitset_size);
   init.heap_bitset_base = init.heap_bitset - ((uint64_t)init.heap_start >> 6);
   memset(init.heap_bitset, 0, min_bitset_size);
 
@@ -1212,8 +2043,19 @@ STANZA_API_FUNC int main (int argc, char* argv[]) {
     exit(-1);
   }
 
+  //Allocate dirty card summary for heap
+  const stz_long min_dirty_cards_size = dirty_cards_size(min_heap_size);
+  const stz_long max_dirty_cards_size = dirty_cards_size(max_heap_size);
+  const stz_long large_object_dirty_cards_size = large_object_space_size >> (LOG_BYTES_IN_CARD + LOG_BITS_IN_BYTE);
+  stz_byte* dirty_cards_space = (stz_byte*)stz_memory_map(0, large_object_dirty_cards_size + max_dirty_cards_size);
+  init.heap_dirty_cards = dirty_cards_space + large_object_dirty_cards_size;
+  stz_memory_commit(init.heap_dirty_cards, min_dirty_cards_size);
+  init.heap_dirty_cards_base = init.heap_dirty_cards
+                             - (((uint64_t)init.heap_start >> (LOG_BYTES_IN_CARD + LOG_BITS_IN_LONG)) << LOG_BYTES_IN_LONG);
+  memset(init.heap_dirty_cards, 0, min_dirty_cards_size);
+
   //Allocate marking stack for heap
-  const stz_long marking_stack_size = ROUND_UP_TO_WHOLE_PAGES((1024 * 1024L) << LOG_BYTES_IN_LONG);
+  const stz_long marking_stack_size = ROUND_UP_TO_WHOLE_PAGES(stz_marking_stack_size << LOG_BYTES_IN_LONG);
   init.marking_stack_start = stz_memory_map(marking_stack_size, marking_stack_size);
   init.marking_stack_bottom = init.marking_stack_start + marking_stack_size;
   init.marking_stack_top = init.marking_stack_bottom;
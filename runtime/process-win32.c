@@ -273,7 +273,6 @@ stz_int launch_process(stz_byte* command_line,
   if (success) {
     // Populate process with the relevant info
     process->pid = (stz_long)proc_info.dwProcessId;
-    process->pipeid = -1; // -1 signals we didn't create named pipes for this process
     process->handle = (void*)proc_info.hProcess;
     process->in  = file_from_handle(stdin_write, FT_WRITE);
     process->out = file_from_handle(stdout_read, FT_READ);